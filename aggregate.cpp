@@ -0,0 +1,291 @@
+/*aggregate.cpp*/
+
+// Aggregate functions for myDB project
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+
+#include "aggregate.h"
+#include "scan.h"
+#include "parallel.h"
+#include "stats.h"
+
+using namespace std;
+
+
+//
+// _comparetext
+//
+// Compares a and b the way string::compare does: <0, 0 or >0.
+//
+static int _comparetext(const char* a, size_t alength, const string& b)
+{
+	int result = memcmp(a, b.data(), min(alength, b.size()));
+	
+	if (result != 0)
+		return result;
+	else if (alength == b.size())
+		return 0;
+	else
+		return (alength < b.size()) ? -1 : 1;
+}
+
+
+//
+// aggregate::add
+//
+// Adds one column value to the result.  count counts every value (the
+// caller skips deleted records); the other functions skip values that
+// aren't valid for the column's type.
+//
+void aggregate::add(const char* data, size_t length)
+{
+	if (Function == AGG_COUNT)
+	{
+		Count++;
+		return;
+	}
+	
+	int64_t integer = 0;
+	double real = 0;
+	bool better = (Count == 0);
+	
+	// parse the value, and for min/max see if it beats the one so far
+	if (Type == TYPE_STRING)
+	{
+		if (Function == AGG_SUM || Function == AGG_AVG)
+			return;
+		
+		if (!better)
+		{
+			int compare = _comparetext(data, length, Text);
+			better = (Function == AGG_MIN) ? compare < 0 : compare > 0;
+		}
+	}
+	else if (Type == TYPE_DOUBLE)
+	{
+		if (!ParseValue(data, length, Type, real))
+			return;
+		
+		if (!better)
+			better = (Function == AGG_MIN) ? real < Real : real > Real;
+	}
+	else
+	{
+		if (!ParseValue(data, length, Type, integer))
+			return;
+		
+		if (!better)
+			better = (Function == AGG_MIN) ? integer < Integer : integer > Integer;
+	}
+	
+	Count++;
+	
+	if (Function == AGG_SUM || Function == AGG_AVG)
+	{
+		Integer += integer;
+		Real += real;
+	}
+	else if (better)
+	{
+		Integer = integer;
+		Real = real;
+		Text.assign(data, length);
+	}
+}
+
+
+//
+// aggregate::merge
+//
+// Adds another result for the same function and column, from a
+// different run of records.
+//
+void aggregate::merge(const aggregate& other)
+{
+	if (other.Count == 0)
+		return;
+	
+	if (Function == AGG_MIN || Function == AGG_MAX)
+	{
+		// other's min/max is one of its values, so adding it settles it
+		int64_t count = Count;
+		
+		add(other.Text.data(), other.Text.size());
+		Count = count + other.Count;
+		return;
+	}
+	
+	Count += other.Count;
+	Integer += other.Integer;
+	Real += other.Real;
+}
+
+
+//
+// aggregate::print
+//
+// Outputs the result as "name: value", e.g. "count(*): 581".  min, max
+// and avg of no values output "Not found...".
+//
+void aggregate::print(string name, ostream& output) const
+{
+	ostringstream value;
+	value.precision(15);
+	
+	if (Function == AGG_COUNT)
+		value << Count;
+	else if (Count == 0 && Function != AGG_SUM)
+	{
+		output << "Not found...\n";
+		return;
+	}
+	else if (Function == AGG_MIN || Function == AGG_MAX)
+		value << Text;
+	else if (Function == AGG_SUM && Type == TYPE_DOUBLE)
+		value << Real;
+	else if (Function == AGG_SUM)
+		value << Integer;
+	else if (Type == TYPE_DOUBLE)
+		value << Real / Count;
+	else
+		value << (double) Integer / Count;
+	
+	output << name << ": " << value.str() << endl;
+}
+
+
+//
+// ParseAggregate
+//
+// Parses a select column of the form fn(col) into the function and its
+// column: count(*), or min, max, sum or avg of a column.  Returns false
+// if the token isn't an aggregate.
+//
+// Example: ParseAggregate("max(capacity)", fn, col) sets fn to AGG_MAX
+// and col to "capacity".
+//
+bool ParseAggregate(string token, aggregatefn& function, string& column)
+{
+	size_t open = token.find('(');
+	
+	if (open == string::npos || token.size() < open + 3 || token.back() != ')')
+		return false;
+	
+	string name = token.substr(0, open);
+	column = token.substr(open + 1, token.size() - open - 2);
+	
+	if (name == "count")
+		function = AGG_COUNT;
+	else if (name == "min")
+		function = AGG_MIN;
+	else if (name == "max")
+		function = AGG_MAX;
+	else if (name == "sum")
+		function = AGG_SUM;
+	else if (name == "avg")
+		function = AGG_AVG;
+	else
+		return false;
+	
+	// count only counts records, the others need a column
+	return (function == AGG_COUNT) == (column == "*");
+}
+
+
+//
+// _scanaggregaterange
+//
+// ScanAggregate over records [firstRecord, lastRecord), see below.
+//
+static aggregate _scanaggregaterange(const datatable& table, int column, const aggregate& empty,
+									 streamoff firstRecord, streamoff lastRecord)
+{
+	aggregate result = empty;
+	size_t recordsize = table.recordsize();
+	recordpin pin;
+	
+	for (streamoff rec = firstRecord; rec < lastRecord; rec++)
+	{
+		const char* record = pin.at(table, rec * recordsize);
+		
+		// skip deleted records
+		if (record[0] == '.')
+			continue;
+		
+		// count(*) never needs to find a column
+		if (result.Function == AGG_COUNT)
+		{
+			result.Count++;
+			continue;
+		}
+		
+		fieldview field = FindColumn(record, recordsize, column);
+		result.add(field.Data, field.Length);
+	}
+	
+	return result;
+}
+
+
+//
+// ScanAggregate
+//
+// Aggregates a column (0-based) of every live record in one streaming
+// pass over the table, starting from the empty result given.  The
+// records are split across numThreads threads like ParallelScanColumn,
+// each thread aggregating its own range, and the partial results are
+// merged at the end.
+//
+aggregate ScanAggregate(const datatable& table, int column, const aggregate& empty, int numThreads)
+{
+	StatCount(COUNT_BYTESREAD, table.numrecords() * table.recordsize());
+	
+	if (!table.good())
+		return empty;
+	
+	return SplitRecords(table.numrecords(), numThreads, empty,
+		[&table, &empty, column](streamoff first, streamoff last)
+		{
+			return _scanaggregaterange(table, column, empty, first, last);
+		},
+		[](aggregate& result, const aggregate& part)
+		{
+			result.merge(part);
+		});
+}
+
+
+//
+// AggregatePositions
+//
+// Adds a column (0-based) of the records at the given positions to the
+// result, e.g. the matches of a where clause.  count(*) only counts
+// the positions.
+//
+void AggregatePositions(const datatable& table, const vector<streamoff>& positions, int column, aggregate& result)
+{
+	if (result.Function == AGG_COUNT)
+	{
+		result.Count += positions.size();
+		return;
+	}
+	
+	size_t recordsize = table.recordsize();
+	recordpin pin;
+	
+	StatCount(COUNT_BYTESREAD, positions.size() * recordsize);
+	
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		const char* record = pin.at(table, positions[i]);
+		fieldview field = FindColumn(record, recordsize, column);
+		
+		result.add(field.Data, field.Length);
+	}
+}
@@ -0,0 +1,60 @@
+/*aggregate.h*/
+
+// Aggregate functions for myDB project
+
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "table.h"
+#include "types.h"
+
+using namespace std;
+
+// function in "select fn(col) from ..."
+enum aggregatefn
+{
+	AGG_COUNT, // count(*)
+	AGG_MIN,   // min(col)
+	AGG_MAX,   // max(col)
+	AGG_SUM,   // sum(col), int and double columns
+	AGG_AVG    // avg(col), int and double columns
+};
+
+//
+// aggregate
+//
+// The running result of one aggregate function over a column's values.
+// Values are compared and summed as the column's type; ones that aren't
+// valid for the type are skipped.  Partial results from separate runs
+// of records combine with merge.
+//
+struct aggregate
+{
+	aggregatefn Function;
+	columntype Type;  // type of the aggregated column
+	int64_t Count;    // # of values (records for count) aggregated so far
+	int64_t Integer;  // sum of an int column, or the int/date min/max
+	double Real;      // sum of a double column, or the double min/max
+	string Text;      // min/max as it appears in the record
+	
+	aggregate(aggregatefn function, columntype type)
+		: Function(function), Type(type), Count(0), Integer(0), Real(0)
+	{
+	}
+	
+	void add(const char* data, size_t length);
+	
+	void merge(const aggregate& other);
+	
+	void print(string name, ostream& output) const;
+};
+
+bool ParseAggregate(string token, aggregatefn& function, string& column);
+
+aggregate ScanAggregate(const datatable& table, int column, const aggregate& empty, int numThreads);
+
+void AggregatePositions(const datatable& table, const vector<streamoff>& positions, int column, aggregate& result);
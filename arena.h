@@ -0,0 +1,185 @@
+/*arena.h*/
+
+// Node allocators for avltree in myDB project
+
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+
+using namespace std;
+
+//
+// Allocator interface
+//
+// An allocator hands out default-constructed nodes one at a time:
+//   allocate()        new node
+//   deallocate(node)  destroy one node and give its memory back
+//   needsdestroy()    true if every node has to be destroyed one by one
+//                     before release(), false if release() alone is enough
+//   destroy(node)     run the node's destructor only (used before release)
+//   release()         free everything the allocator is holding
+//
+
+// nodeheap allocator (one new/delete per node)
+template<typename T>
+class nodeheap
+{
+public:
+	T* allocate()
+	{
+		return new T();
+	}
+	
+	void deallocate(T* node)
+	{
+		delete node;
+	}
+	
+	bool needsdestroy()
+	{
+		return true;
+	}
+	
+	void destroy(T* node)
+	{
+		delete node;
+	}
+	
+	void release()
+	{
+	}
+};
+
+// nodearena allocator (nodes carved out of big contiguous blocks)
+template<typename T>
+class nodearena
+{
+private:
+	union SLOT
+	{
+		SLOT* Next;
+		typename aligned_storage<sizeof(T), alignof(T)>::type Storage;
+	};
+	
+	// first block holds MINBLOCK slots, each new block doubles up to MAXBLOCK
+	static const size_t MINBLOCK = 32;
+	static const size_t MAXBLOCK = 65536;
+	
+	std::vector<SLOT*> Blocks;
+	size_t BlockSlots; // slots in the newest block
+	size_t Used;       // slots handed out from the newest block
+	SLOT* FreeList;    // slots given back by deallocate()
+	
+	// no copies, each arena owns its blocks
+	nodearena(const nodearena& other);
+	nodearena& operator=(const nodearena& other);
+	
+public:
+	nodearena()
+	{
+		BlockSlots = 0;
+		Used = 0;
+		FreeList = nullptr;
+	}
+	
+	// move constructor (take over other's blocks)
+	nodearena(nodearena&& other) noexcept
+		: Blocks(std::move(other.Blocks))
+	{
+		BlockSlots = other.BlockSlots;
+		Used = other.Used;
+		FreeList = other.FreeList;
+		
+		other.Blocks.clear();
+		other.BlockSlots = 0;
+		other.Used = 0;
+		other.FreeList = nullptr;
+	}
+	
+	// move assignment (free our blocks, take over other's)
+	nodearena& operator=(nodearena&& other) noexcept
+	{
+		if (this != &other)
+		{
+			release();
+			
+			Blocks = std::move(other.Blocks);
+			BlockSlots = other.BlockSlots;
+			Used = other.Used;
+			FreeList = other.FreeList;
+			
+			other.Blocks.clear();
+			other.BlockSlots = 0;
+			other.Used = 0;
+			other.FreeList = nullptr;
+		}
+		
+		return *this;
+	}
+	
+	~nodearena()
+	{
+		release();
+	}
+	
+	T* allocate()
+	{
+		SLOT* slot;
+		
+		// reuse a freed slot first, then the newest block, then a new block
+		if (FreeList != nullptr)
+		{
+			slot = FreeList;
+			FreeList = FreeList->Next;
+		}
+		else
+		{
+			if (Used == BlockSlots)
+			{
+				BlockSlots = (BlockSlots == 0) ? (size_t) MINBLOCK : std::min(BlockSlots * 2, (size_t) MAXBLOCK);
+				Blocks.push_back(static_cast<SLOT*>(::operator new(BlockSlots * sizeof(SLOT))));
+				Used = 0;
+			}
+			
+			slot = &Blocks.back()[Used];
+			Used++;
+		}
+		
+		return new (&slot->Storage) T();
+	}
+	
+	void deallocate(T* node)
+	{
+		node->~T();
+		
+		SLOT* slot = reinterpret_cast<SLOT*>(node);
+		slot->Next = FreeList;
+		FreeList = slot;
+	}
+	
+	bool needsdestroy()
+	{
+		return !is_trivially_destructible<T>::value;
+	}
+	
+	void destroy(T* node)
+	{
+		node->~T();
+	}
+	
+	void release()
+	{
+		for (size_t i = 0; i < Blocks.size(); i++)
+			::operator delete(Blocks[i]);
+		
+		Blocks.clear();
+		BlockSlots = 0;
+		Used = 0;
+		FreeList = nullptr;
+	}
+};
@@ -6,10 +6,17 @@
 #include <stack>
 #include <vector>
 #include <cassert>
+#include <utility>
+
+#include "arena.h"
+#include "frozen.h"
+#include "stats.h"
 
 using namespace std;
 
-template<typename TKey, typename TValue>
+// TAllocator is the node allocator policy (see arena.h), nodearena by
+// default so nodes sit in big blocks and clear() frees blocks, not nodes
+template<typename TKey, typename TValue, template<typename> class TAllocator = nodearena>
 class avltree
 {
 private:
@@ -24,6 +31,7 @@ private:
 	
 	NODE* Root;
 	int Size;
+	TAllocator<NODE> Alloc;
 	
 	// _height private function to get height of tree 
 	// private instead of public for rotate functions
@@ -90,6 +98,22 @@ private:
 		}
 	}
 	
+	// _balanced private function to check every node's height is
+	// stored right and its subtrees' heights differ by at most 1
+	bool _balanced(NODE* curNode)
+	{
+		if (curNode == nullptr)
+			return true;
+		
+		int leftHeight = _height(curNode->Left);
+		int rightHeight = _height(curNode->Right);
+		
+		if (curNode->Height != 1 + std::max(leftHeight, rightHeight) || std::abs(leftHeight - rightHeight) > 1)
+			return false;
+		
+		return _balanced(curNode->Left) && _balanced(curNode->Right);
+	}
+	
 	// _cleartree private function to empty tree/free up tree memory
 	void _cleartree(NODE* curNode)
 	{
@@ -99,26 +123,58 @@ private:
 		{
 			_cleartree(curNode->Left);
 			_cleartree(curNode->Right);
-			delete curNode;
+			Alloc.destroy(curNode);
 			Size--; // decrease size for every deleted node
 		}
 	}
 	
 	// _copytree private function to create a copied tree
-	void _copytree(NODE* curNode)
+	// clones node for node, so the copy has the same shape and heights
+	// in O(n) without re-inserting/rebalancing; returns the copy's root
+	NODE* _copytree(NODE* curNode)
 	{
 		if (curNode == nullptr)
-			return;
+			return nullptr;
 		else
 		{
-			// reinsert each node into tree copy
-			insert(curNode->Key, curNode->Value);
+			NODE* newNode = Alloc.allocate();
+			newNode->Key = curNode->Key;
+			newNode->Value = curNode->Value;
+			newNode->Height = curNode->Height;
+			newNode->Left = _copytree(curNode->Left);
+			newNode->Right = _copytree(curNode->Right);
 			
-			_copytree(curNode->Left);
-			_copytree(curNode->Right);
+			Size++;
+			
+			return newNode;
 		}
 	}
 	
+	// _buildtree private function to build a balanced subtree from sorted keys/values
+	// covers the index range [low, high), returns root of the subtree
+	NODE* _buildtree(const std::vector<TKey>& keys, const std::vector<TValue>& values,
+					 size_t low, size_t high)
+	{
+		if (low >= high)
+			return nullptr;
+		else
+		{
+			size_t mid = low + (high - low) / 2;
+
+			NODE* newNode = Alloc.allocate();
+			newNode->Key = keys[mid];
+			newNode->Value = values[mid];
+			newNode->Left = _buildtree(keys, values, low, mid);
+			newNode->Right = _buildtree(keys, values, mid + 1, high);
+			newNode->Height = std::max(_height(newNode->Left),
+									   _height(newNode->Right)) + 1;
+
+			Size++;
+
+			return newNode;
+		}
+	}
+
 	// _distancefromnode private function to determine key distance from given node
 	int _distancefromnode(NODE* curNode, TKey key)
 	{
@@ -149,6 +205,8 @@ private:
 	// _rightrotate private function to rotate right around given node
 	void _rightrotate(NODE* parentNode, NODE* curNode)
 	{
+		StatCount(COUNT_ROTATIONS, 1);
+		
 		assert(curNode != nullptr);
 		assert(curNode->Left != nullptr);
 		
@@ -176,6 +234,8 @@ private:
 	// _leftrotate private function to rotate left around given node
 	void _leftrotate(NODE* parentNode, NODE* curNode)
 	{
+		StatCount(COUNT_ROTATIONS, 1);
+		
 		assert(curNode != nullptr);
 		assert(curNode->Right != nullptr);
 		
@@ -220,7 +280,8 @@ private:
 			else
 				subRight = -1;
 				
-			if (subLeft > subRight)
+			// (equal subtrees only happen after erase, a single rotation fixes them)
+			if (subLeft >= subRight)
 				_rightrotate(parentNode, curNode);
 			else
 			{
@@ -242,7 +303,7 @@ private:
 			else
 				subRight = -1;
 				
-			if (subLeft < subRight)
+			if (subLeft <= subRight)
 				_leftrotate(parentNode, curNode);
 			else
 			{
@@ -254,6 +315,48 @@ private:
 	
 
 public:
+	// iterator class (inorder walk from a starting key, see begin/lower_bound/upper_bound)
+	class iterator
+	{
+	private:
+		stack<NODE*> Path; // nodes left to visit on the walk, current node on top
+		
+		friend class avltree;
+		
+	public:
+		// done function (true once the walk is past the last node)
+		bool done() const
+		{
+			return Path.empty();
+		}
+		
+		// key function (current node's key)
+		const TKey& key() const
+		{
+			return Path.top()->Key;
+		}
+		
+		// value function (current node's value)
+		TValue& value() const
+		{
+			return Path.top()->Value;
+		}
+		
+		// next function (move to the next key in order)
+		void next()
+		{
+			NODE* curNode = Path.top()->Right;
+			Path.pop();
+			
+			// successor is the leftmost node of the right subtree, if any
+			while (curNode != nullptr)
+			{
+				Path.push(curNode);
+				curNode = curNode->Left;
+			}
+		}
+	};
+	
 	// default contructor
 	avltree()
 	{
@@ -267,13 +370,55 @@ public:
 		Root = nullptr;
 		Size = 0;
 		
-		_copytree(other.Root);
+		Root = _copytree(other.Root);
+	}
+	
+	// move constructor (takes other's nodes, other is left empty)
+	avltree(avltree&& other) noexcept
+		: Alloc(std::move(other.Alloc))
+	{
+		Root = other.Root;
+		Size = other.Size;
+		
+		other.Root = nullptr;
+		other.Size = 0;
+	}
+	
+	// copy assignment
+	avltree& operator=(const avltree& other)
+	{
+		if (this != &other)
+		{
+			clear();
+			
+			Root = _copytree(other.Root);
+		}
+		
+		return *this;
+	}
+	
+	// move assignment (frees this tree, takes other's nodes)
+	avltree& operator=(avltree&& other) noexcept
+	{
+		if (this != &other)
+		{
+			clear();
+			
+			Alloc = std::move(other.Alloc);
+			Root = other.Root;
+			Size = other.Size;
+			
+			other.Root = nullptr;
+			other.Size = 0;
+		}
+		
+		return *this;
 	}
 	
 	// destructor
 	virtual ~avltree()
 	{
-		_cleartree(Root);
+		clear();
 	}
 	
 	// size function (num of nodes in tree)
@@ -294,7 +439,11 @@ public:
 	// clear function
 	void clear()
 	{
-		_cleartree(Root);
+		// nodes only need visiting if they have destructors to run,
+		// the allocator frees their memory all at once after
+		if (Alloc.needsdestroy())
+			_cleartree(Root);
+		Alloc.release();
 		
 		// reset root and size for new tree
 		Root = nullptr;
@@ -305,13 +454,16 @@ public:
 	TValue* search(TKey key)
 	{
 		NODE* curNode = Root;
+		uint64_t visited = 0;
 		
 		// traverse tree
 		while (curNode != nullptr)
 		{
-			// key is found, return node's value
+			visited++;
+			
+			// key is found, stop at its node
 			if (key == curNode->Key)
-				return &curNode->Value;
+				break;
 			
 			if (key < curNode->Key)
 				curNode = curNode->Left;
@@ -319,8 +471,11 @@ public:
 				curNode = curNode->Right;
 		}
 		
-		// key not found, return null
-		return nullptr;
+		StatCount(COUNT_SEARCHES, 1);
+		StatCount(COUNT_NODESVISITED, visited);
+		
+		// found node's value, or null if key not found
+		return (curNode != nullptr) ? &curNode->Value : nullptr;
 	}
 	
 	// insert function (insert node into tree appropriately)
@@ -351,7 +506,7 @@ public:
 			}
 		}
 		
-		NODE* newNode = new NODE();
+		NODE* newNode = Alloc.allocate();
 		newNode->Key = key;
 		newNode->Value = value;
 		newNode->Height = 0;
@@ -406,6 +561,208 @@ public:
 		return;
 	}
 	
+	// build function (replace tree with a balanced tree of sorted keys/values)
+	// keys must be in strictly increasing order, values match keys by position;
+	// runs in O(n) instead of n separate insert() calls
+	void build(const std::vector<TKey>& keys, const std::vector<TValue>& values)
+	{
+		assert(keys.size() == values.size());
+
+		clear();
+
+		Root = _buildtree(keys, values, 0, keys.size());
+	}
+
+	// erase function (remove node with given key, rebalancing as needed)
+	// returns false if the key is not in the tree
+	bool erase(TKey key)
+	{
+		NODE* prevNode = nullptr;
+		NODE* curNode = Root;
+		
+		stack<NODE*> treeNodes;
+		
+		// search tree for the key, tracking the path down to it
+		while (curNode != nullptr && !(key == curNode->Key))
+		{
+			treeNodes.push(curNode);
+			prevNode = curNode;
+			
+			if (key < curNode->Key)
+				curNode = curNode->Left;
+			else
+				curNode = curNode->Right;
+		}
+		
+		if (curNode == nullptr)
+			return false;
+		
+		// node with two children: swap in its inorder successor (leftmost
+		// node of right subtree), then remove the successor's node instead
+		if (curNode->Left != nullptr && curNode->Right != nullptr)
+		{
+			NODE* succNode = curNode->Right;
+			
+			treeNodes.push(curNode);
+			prevNode = curNode;
+			
+			while (succNode->Left != nullptr)
+			{
+				treeNodes.push(succNode);
+				prevNode = succNode;
+				succNode = succNode->Left;
+			}
+			
+			std::swap(curNode->Key, succNode->Key);
+			std::swap(curNode->Value, succNode->Value);
+			curNode = succNode;
+		}
+		
+		// node now has at most one child, link that child to the parent
+		NODE* childNode = (curNode->Left != nullptr) ? curNode->Left : curNode->Right;
+		
+		if (prevNode == nullptr)
+			Root = childNode;
+		else if (prevNode->Left == curNode)
+			prevNode->Left = childNode;
+		else
+			prevNode->Right = childNode;
+		
+		Alloc.deallocate(curNode);
+		Size--;
+		
+		// walk back up, fixing heights and rotating where AVL status broke
+		while (!treeNodes.empty())
+		{
+			curNode = treeNodes.top();
+			treeNodes.pop();
+			
+			int leftHeight = _height(curNode->Left);
+			int rightHeight = _height(curNode->Right);
+			
+			curNode->Height = 1 + std::max(leftHeight, rightHeight);
+			
+			// track previous node from current node
+			if (treeNodes.empty())
+				prevNode = nullptr;
+			else
+				prevNode = treeNodes.top();
+			
+			// if AVL status broken with height difference > 1, rotate tree accordingly
+			if (std::abs(leftHeight - rightHeight) > 1)
+				_rotatetofix(prevNode, curNode);
+		}
+		
+		return true;
+	}
+	
+	// begin function (iterator at the smallest key)
+	iterator begin()
+	{
+		iterator it;
+		NODE* curNode = Root;
+		
+		while (curNode != nullptr)
+		{
+			it.Path.push(curNode);
+			curNode = curNode->Left;
+		}
+		
+		return it;
+	}
+	
+	// first function (value of the smallest key, the leftmost node, or
+	// null if the tree is empty)
+	TValue* first()
+	{
+		NODE* curNode = Root;
+		
+		if (curNode == nullptr)
+			return nullptr;
+		
+		while (curNode->Left != nullptr)
+			curNode = curNode->Left;
+		
+		return &curNode->Value;
+	}
+	
+	// last function (value of the largest key, the rightmost node, or
+	// null if the tree is empty)
+	TValue* last()
+	{
+		NODE* curNode = Root;
+		
+		if (curNode == nullptr)
+			return nullptr;
+		
+		while (curNode->Right != nullptr)
+			curNode = curNode->Right;
+		
+		return &curNode->Value;
+	}
+	
+	// lower_bound function (iterator at the first key >= given key)
+	iterator lower_bound(TKey key)
+	{
+		iterator it;
+		NODE* curNode = Root;
+		
+		uint64_t visited = 0;
+		
+		// keep every node we turn left at, they come after the nodes below them
+		while (curNode != nullptr)
+		{
+			visited++;
+			
+			if (curNode->Key < key)
+				curNode = curNode->Right;
+			else
+			{
+				it.Path.push(curNode);
+				curNode = curNode->Left;
+			}
+		}
+		
+		StatCount(COUNT_SEARCHES, 1);
+		StatCount(COUNT_NODESVISITED, visited);
+		
+		return it;
+	}
+	
+	// upper_bound function (iterator at the first key > given key)
+	iterator upper_bound(TKey key)
+	{
+		iterator it;
+		NODE* curNode = Root;
+		
+		uint64_t visited = 0;
+		
+		while (curNode != nullptr)
+		{
+			visited++;
+			
+			if (key < curNode->Key)
+			{
+				it.Path.push(curNode);
+				curNode = curNode->Left;
+			}
+			else
+				curNode = curNode->Right;
+		}
+		
+		StatCount(COUNT_SEARCHES, 1);
+		StatCount(COUNT_NODESVISITED, visited);
+		
+		return it;
+	}
+	
+	// freeze function (read-only snapshot of the tree laid out for fast
+	// searches, see frozen.h; later changes to the tree don't show in it)
+	frozentree<TKey, TValue> freeze()
+	{
+		return frozentree<TKey, TValue>(inorder_keys(), inorder_values());
+	}
+	
 	// distance function (distance between two given keys)
 	int distance(TKey k1, TKey k2)
 	{
@@ -461,4 +818,10 @@ public:
 		
 		return heightsVect;
 	}
+	
+	// balanced function (true if the tree keeps the AVL balance, for tests)
+	bool balanced()
+	{
+		return _balanced(Root);
+	}
 };
\ No newline at end of file
@@ -0,0 +1,675 @@
+/*bench.cpp*/
+
+// Performance benchmarks for myDB project
+//
+// Usage: bench.exe [--rows N,N,...] [--filter TEXT] [--min-time SECONDS]
+//                  [--json FILE]
+//
+// Every benchmark runs once per row count (10K, 100K and 1M rows by
+// default) in its own process, so no run can reuse memory freed by
+// another.  A benchmark repeats its timed loop until it has run for the
+// minimum time, and reports the time per item and items per second (an
+// item is one insert, one search, one record, ...).  Results go to the
+// console as a table, and to a JSON file in the same layout Google
+// Benchmark uses, so runs can be compared over time.
+//
+// The table benchmarks run over a synthetic table written next to the
+// benchmark ("bench<rows>.data" and ".meta", removed afterwards).
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <thread>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "avl.h"
+#include "compactavl.h"
+#include "postings.h"
+#include "table.h"
+#include "util.h"
+
+using namespace std;
+
+
+//
+// ResidentBytes
+//
+// Returns the resident set size of this process, in bytes.
+//
+static long ResidentBytes()
+{
+	long pages = 0, resident = 0;
+	ifstream statm("/proc/self/statm");
+
+	statm >> pages >> resident;
+
+	return resident * sysconf(_SC_PAGESIZE);
+}
+
+
+//
+// benchstate
+//
+// Handed to each benchmark, which does its setup and then runs its timed
+// loop as long as keeprunning() says so:
+//
+//   while (state.keeprunning())
+//   {
+//       ...one iteration...
+//       state.additems(n);
+//   }
+//
+// Work that shouldn't count (like freeing what an iteration built) goes
+// between pause() and resume().
+//
+class benchstate
+{
+private:
+	chrono::steady_clock::time_point Start;
+	bool Running;
+	double MinTime;
+
+public:
+	long Rows;
+	long Iterations;
+	long Items;
+	double Seconds;
+	long ResidentKB;  // memory the benchmark reports using, -1 if none
+
+	benchstate(long rows, double minTime)
+	{
+		Running = false;
+		MinTime = minTime;
+		Rows = rows;
+		Iterations = 0;
+		Items = 0;
+		Seconds = 0;
+		ResidentKB = -1;
+	}
+
+	// keeprunning function (true until the minimum time has passed)
+	bool keeprunning()
+	{
+		if (Iterations > 0)
+			pause();
+
+		if (Seconds >= MinTime)
+			return false;
+
+		Iterations++;
+		resume();
+
+		return true;
+	}
+
+	void pause()
+	{
+		if (Running)
+			Seconds += chrono::duration<double>(chrono::steady_clock::now() - Start).count();
+
+		Running = false;
+	}
+
+	void resume()
+	{
+		Start = chrono::steady_clock::now();
+		Running = true;
+	}
+
+	void additems(long n)
+	{
+		Items += n;
+	}
+};
+
+
+//
+// Keys
+//
+// Distinct keys "key000000000", "key000000001", ... in the given order:
+// sorted, random, or adversarial (alternating from both ends towards the
+// middle, so nearly every insert rebalances).
+//
+enum keyorder { KEYS_SORTED, KEYS_RANDOM, KEYS_ADVERSARIAL };
+
+static string Key(long i)
+{
+	char buffer[32];
+
+	snprintf(buffer, sizeof(buffer), "key%09ld", i);
+
+	return buffer;
+}
+
+static vector<string> MakeKeys(long n, keyorder order)
+{
+	vector<string> keys;
+
+	keys.reserve(n);
+
+	if (order == KEYS_ADVERSARIAL)
+	{
+		for (long low = 0, high = n - 1; low <= high; low++, high--)
+		{
+			keys.push_back(Key(low));
+
+			if (high != low)
+				keys.push_back(Key(high));
+		}
+	}
+	else
+	{
+		for (long i = 0; i < n; i++)
+			keys.push_back(Key(i));
+
+		if (order == KEYS_RANDOM)
+			shuffle(keys.begin(), keys.end(), mt19937(42));
+	}
+
+	return keys;
+}
+
+// probes that are all absent from MakeKeys(n), interleaved with its keys
+static vector<string> MakeMisses(long n)
+{
+	vector<string> probes;
+
+	probes.reserve(n);
+
+	for (long i = 0; i < n; i++)
+		probes.push_back(Key(i) + "x");
+
+	shuffle(probes.begin(), probes.end(), mt19937(7));
+
+	return probes;
+}
+
+
+//
+// MakeTable
+//
+// Writes a synthetic table "<name>.data" with its "<name>.meta": rows
+// records of 64 bytes in the same dot-padded, space-separated layout as
+// the sample tables.  Columns: id (unique, shuffled, indexed), name
+// (random letters, indexed), score, city (200 distinct values) and date.
+//
+static const int BENCHRECORDSIZE = 64;
+
+static void MakeTable(string name, long rows)
+{
+	ofstream meta(name + ".meta", ios::out | ios::binary);
+
+	meta << BENCHRECORDSIZE << "\n5\nid 1\nname 1\nscore 0\ncity 0\ndate 0\n";
+
+	FILE* data = fopen((name + ".data").c_str(), "wb");
+	mt19937 random(1);
+	vector<long> ids(rows);
+
+	for (long i = 0; i < rows; i++)
+		ids[i] = i;
+
+	shuffle(ids.begin(), ids.end(), random);
+
+	string buffer;
+	char record[BENCHRECORDSIZE + 1];
+	char letters[9];
+
+	for (long i = 0; i < rows; i++)
+	{
+		for (int j = 0; j < 8; j++)
+			letters[j] = 'a' + random() % 26;
+		letters[8] = '\0';
+
+		int n = snprintf(record, sizeof(record), "%ld %s %lu city%03lu %lu/%lu/20%02lu ",
+						 ids[i], letters, random() % 100000, random() % 200,
+						 random() % 12 + 1, random() % 28 + 1, random() % 25);
+
+		memset(record + n, '.', BENCHRECORDSIZE - 2 - n);
+		record[BENCHRECORDSIZE - 2] = '\r';
+		record[BENCHRECORDSIZE - 1] = '\n';
+
+		buffer.append(record, BENCHRECORDSIZE);
+
+		if (buffer.size() >= (1 << 20))
+		{
+			fwrite(buffer.data(), 1, buffer.size(), data);
+			buffer.clear();
+		}
+	}
+
+	fwrite(buffer.data(), 1, buffer.size(), data);
+	fclose(data);
+}
+
+static string TableName(long rows)
+{
+	return "bench" + to_string(rows);
+}
+
+
+//
+// Benchmarks
+//
+
+// avltree insert of every key, in the given order, into a fresh tree
+template<keyorder ORDER, template<typename> class TAllocator = nodearena>
+static void BenchInsert(benchstate& state)
+{
+	vector<string> keys = MakeKeys(state.Rows, ORDER);
+
+	while (state.keeprunning())
+	{
+		long before = ResidentBytes();
+		avltree<string, streamoff, TAllocator>* tree = new avltree<string, streamoff, TAllocator>();
+
+		for (size_t i = 0; i < keys.size(); i++)
+			tree->insert(keys[i], i);
+
+		state.additems(keys.size());
+
+		state.pause();
+		if (state.ResidentKB < 0)
+			state.ResidentKB = (ResidentBytes() - before) / 1024;
+		delete tree;
+		state.resume();
+	}
+}
+
+// search of every key (or of keys that aren't there) in a tree type
+template<typename TTree, bool HIT>
+static void BenchSearch(benchstate& state)
+{
+	vector<string> keys = MakeKeys(state.Rows, KEYS_RANDOM);
+	vector<string> probes = HIT ? MakeKeys(state.Rows, KEYS_RANDOM) : MakeMisses(state.Rows);
+	TTree tree;
+
+	for (size_t i = 0; i < keys.size(); i++)
+		tree.insert(keys[i], i);
+
+	if (HIT)
+		shuffle(probes.begin(), probes.end(), mt19937(7));
+
+	size_t found = 0;
+
+	while (state.keeprunning())
+	{
+		for (size_t i = 0; i < probes.size(); i++)
+			found += (tree.search(probes[i]) != nullptr);
+
+		state.additems(probes.size());
+	}
+
+	if (found == 1)  // keep the searches from being optimized away
+		cout << "";
+}
+
+// search of every key in a frozen snapshot of the tree
+static void BenchFrozenSearch(benchstate& state)
+{
+	vector<string> keys = MakeKeys(state.Rows, KEYS_RANDOM);
+	avltree<string, streamoff> tree;
+
+	for (size_t i = 0; i < keys.size(); i++)
+		tree.insert(keys[i], i);
+
+	frozentree<string, streamoff> frozen = tree.freeze();
+	tree.clear();
+	shuffle(keys.begin(), keys.end(), mt19937(7));
+
+	size_t found = 0;
+
+	while (state.keeprunning())
+	{
+		for (size_t i = 0; i < keys.size(); i++)
+			found += (frozen.search(keys[i]) != nullptr);
+
+		state.additems(keys.size());
+	}
+
+	if (found == 1)
+		cout << "";
+}
+
+// in-order walk of the tree's keys
+static void BenchInorderKeys(benchstate& state)
+{
+	vector<string> keys = MakeKeys(state.Rows, KEYS_RANDOM);
+	avltree<string, streamoff> tree;
+
+	for (size_t i = 0; i < keys.size(); i++)
+		tree.insert(keys[i], i);
+
+	while (state.keeprunning())
+	{
+		vector<string> inorder = tree.inorder_keys();
+
+		state.additems(inorder.size());
+
+		state.pause();
+		inorder.clear();
+		state.resume();
+	}
+}
+
+// copy construction of the whole tree
+static void BenchCopy(benchstate& state)
+{
+	vector<string> keys = MakeKeys(state.Rows, KEYS_RANDOM);
+	avltree<string, streamoff> tree;
+
+	for (size_t i = 0; i < keys.size(); i++)
+		tree.insert(keys[i], i);
+
+	while (state.keeprunning())
+	{
+		avltree<string, streamoff>* copy = new avltree<string, streamoff>(tree);
+
+		state.additems(copy->size());
+
+		state.pause();
+		delete copy;
+		state.resume();
+	}
+}
+
+// GetRecord of records at random positions of the synthetic table
+static void BenchGetRecord(benchstate& state)
+{
+	datatable table;
+
+	table.open(TableName(state.Rows), BENCHRECORDSIZE, 5);
+
+	vector<streamoff> positions(table.numrecords());
+	mt19937 random(3);
+
+	for (size_t i = 0; i < positions.size(); i++)
+		positions[i] = (random() % table.numrecords()) * BENCHRECORDSIZE;
+
+	size_t values = 0;
+
+	while (state.keeprunning())
+	{
+		for (size_t i = 0; i < positions.size(); i++)
+			values += GetRecord(table, positions[i]).size();
+
+		state.additems(positions.size());
+	}
+
+	if (values == 1)
+		cout << "";
+}
+
+// LinearSearch of a non-indexed column, one record per item
+template<int THREADS>
+static void BenchLinearSearch(benchstate& state)
+{
+	datatable table;
+
+	table.open(TableName(state.Rows), BENCHRECORDSIZE, 5);
+
+	int numthreads = THREADS > 0 ? THREADS : max(1, (int) thread::hardware_concurrency());
+	size_t matches = 0;
+
+	while (state.keeprunning())
+	{
+		matches += LinearSearch(table, "city042", 3, numthreads).size();
+
+		state.additems(table.numrecords());
+	}
+
+	if (matches == 1)
+		cout << "";
+}
+
+// the startup index build of both indexed columns, done the way main
+// does it: one pass to read the columns, group them into posting lists,
+// build each tree from the sorted keys, then freeze it
+static void BenchIndexBuild(benchstate& state)
+{
+	datatable table;
+
+	table.open(TableName(state.Rows), BENCHRECORDSIZE, 5);
+
+	vector<int> indexcolumns;
+	indexcolumns.push_back(0);
+	indexcolumns.push_back(1);
+
+	while (state.keeprunning())
+	{
+		vector<vector<pair<string, streamoff>>> columns = ReadIndexColumns(table, indexcolumns);
+		vector<avltree<string, postinglist>> trees(indexcolumns.size());
+		vector<frozentree<string, postinglist>> frozen;
+
+		for (size_t i = 0; i < columns.size(); i++)
+		{
+			vector<string> keys;
+			vector<postinglist> values;
+
+			GroupIndexColumn(columns[i], keys, values);
+			trees[i].build(keys, values);
+			frozen.push_back(trees[i].freeze());
+		}
+
+		state.additems(table.numrecords());
+
+		state.pause();
+		columns.clear();
+		trees.clear();
+		frozen.clear();
+		state.resume();
+	}
+}
+
+
+//
+// BENCHMARK
+//
+// A registered benchmark: its name and whether it needs the synthetic
+// table.
+//
+struct BENCHMARK
+{
+	string Name;
+	void (*Run)(benchstate& state);
+	bool NeedsTable;
+};
+
+static vector<BENCHMARK> Benchmarks()
+{
+	vector<BENCHMARK> benchmarks = {
+		{ "avltree/insert/sorted",      BenchInsert<KEYS_SORTED>,      false },
+		{ "avltree/insert/random",      BenchInsert<KEYS_RANDOM>,      false },
+		{ "avltree/insert/adversarial", BenchInsert<KEYS_ADVERSARIAL>, false },
+		{ "avltree/insert/random/nodeheap", BenchInsert<KEYS_RANDOM, nodeheap>, false },
+		{ "avltree/search/hit",         BenchSearch<avltree<string, streamoff>, true>,  false },
+		{ "avltree/search/miss",        BenchSearch<avltree<string, streamoff>, false>, false },
+		{ "compactavltree/search/hit",  BenchSearch<compactavltree<streamoff>, true>,   false },
+		{ "frozentree/search/hit",      BenchFrozenSearch, false },
+		{ "avltree/inorder_keys",       BenchInorderKeys,  false },
+		{ "avltree/copy",               BenchCopy,         false },
+		{ "table/GetRecord",            BenchGetRecord,    true },
+		{ "table/LinearSearch",         BenchLinearSearch<1>, true },
+		{ "table/LinearSearch/threads", BenchLinearSearch<0>, true },
+		{ "index/build",                BenchIndexBuild,   true },
+	};
+
+	return benchmarks;
+}
+
+
+//
+// RunIsolated
+//
+// Runs one benchmark at one row count in a child process, and returns
+// its state as reported back through a pipe.
+//
+static benchstate RunIsolated(const BENCHMARK& benchmark, long rows, double minTime)
+{
+	benchstate state(rows, minTime);
+	int fds[2];
+
+	if (pipe(fds) != 0)
+		return state;
+
+	if (fork() == 0)
+	{
+		close(fds[0]);
+
+		benchmark.Run(state);
+
+		ostringstream result;
+		result << state.Iterations << " " << state.Items << " " << state.Seconds << " " << state.ResidentKB;
+
+		string line = result.str();
+		if (write(fds[1], line.data(), line.size()) < 0)
+			_exit(1);
+
+		_exit(0);
+	}
+
+	close(fds[1]);
+
+	string line;
+	char buffer[256];
+	ssize_t n;
+
+	while ((n = read(fds[0], buffer, sizeof(buffer))) > 0)
+		line.append(buffer, n);
+
+	close(fds[0]);
+	wait(nullptr);
+
+	istringstream result(line);
+	result >> state.Iterations >> state.Items >> state.Seconds >> state.ResidentKB;
+
+	return state;
+}
+
+
+int main(int argc, char* argv[])
+{
+	vector<long> rowcounts = { 10000, 100000, 1000000 };
+	string filter;
+	string jsonfilename = "bench.json";
+	double mintime = 0.5;
+
+	// check command line options:
+	//   --rows N,N,...    row counts (keys per tree, records per table)
+	//   --filter TEXT     only benchmarks whose name contains TEXT
+	//   --min-time S      seconds each benchmark runs for at least
+	//   --json FILE       where to write the results (bench.json)
+	for (int i = 1; i < argc; i++)
+	{
+		string option = argv[i];
+
+		if (option == "--rows" && i + 1 < argc)
+		{
+			rowcounts.clear();
+
+			stringstream list(argv[++i]);
+			string count;
+
+			while (getline(list, count, ','))
+				rowcounts.push_back(atol(count.c_str()));
+		}
+		else if (option == "--filter" && i + 1 < argc)
+			filter = argv[++i];
+		else if (option == "--min-time" && i + 1 < argc)
+			mintime = atof(argv[++i]);
+		else if (option == "--json" && i + 1 < argc)
+			jsonfilename = argv[++i];
+		else
+		{
+			cout << "**Error: unknown option '" << option << "'." << endl;
+			return 0;
+		}
+	}
+
+	vector<BENCHMARK> benchmarks = Benchmarks();
+
+	char host[256] = "";
+	gethostname(host, sizeof(host));
+	time_t now = time(nullptr);
+	char date[64];
+	strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+
+	ofstream json(jsonfilename);
+
+	json << "{\n  \"context\": {\n"
+		 << "    \"date\": \"" << date << "\",\n"
+		 << "    \"host_name\": \"" << host << "\",\n"
+		 << "    \"num_cpus\": " << thread::hardware_concurrency() << ",\n"
+		 << "    \"min_time\": " << mintime << "\n"
+		 << "  },\n  \"benchmarks\": [";
+
+	printf("%-34s %10s %12s %14s %10s %12s\n", "Benchmark", "Rows", "ns/item", "items/s", "Iters", "Resident KB");
+	printf("%s\n", string(97, '-').c_str());
+
+	bool first = true;
+
+	for (size_t r = 0; r < rowcounts.size(); r++)
+	{
+		long rows = rowcounts[r];
+		bool tablemade = false;
+
+		for (size_t b = 0; b < benchmarks.size(); b++)
+		{
+			if (benchmarks[b].Name.find(filter) == string::npos)
+				continue;
+
+			if (benchmarks[b].NeedsTable && !tablemade)
+			{
+				MakeTable(TableName(rows), rows);
+				tablemade = true;
+			}
+
+			benchstate state = RunIsolated(benchmarks[b], rows, mintime);
+
+			double nsperitem = state.Items > 0 ? state.Seconds * 1e9 / state.Items : 0;
+			double itemspersec = state.Seconds > 0 ? state.Items / state.Seconds : 0;
+			string name = benchmarks[b].Name + "/" + to_string(rows);
+
+			printf("%-34s %10ld %12.1f %14.0f %10ld %12s\n", benchmarks[b].Name.c_str(), rows,
+				   nsperitem, itemspersec, state.Iterations,
+				   state.ResidentKB >= 0 ? to_string(state.ResidentKB).c_str() : "");
+			fflush(stdout);
+
+			json << (first ? "\n" : ",\n")
+				 << "    {\n"
+				 << "      \"name\": \"" << name << "\",\n"
+				 << "      \"rows\": " << rows << ",\n"
+				 << "      \"iterations\": " << state.Iterations << ",\n"
+				 << "      \"real_time\": " << nsperitem << ",\n"
+				 << "      \"time_unit\": \"ns\",\n"
+				 << "      \"items_per_second\": " << itemspersec;
+
+			if (state.ResidentKB >= 0)
+				json << ",\n      \"resident_kb\": " << state.ResidentKB;
+
+			json << "\n    }";
+			first = false;
+		}
+
+		if (tablemade)
+		{
+			remove((TableName(rows) + ".data").c_str());
+			remove((TableName(rows) + ".meta").c_str());
+		}
+	}
+
+	json << "\n  ]\n}\n";
+
+	cout << endl << "Results written to " << jsonfilename << endl;
+
+	return 0;
+}
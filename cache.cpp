@@ -0,0 +1,152 @@
+/*cache.cpp*/
+
+// Query result cache for myDB project
+
+#include <iostream>
+#include <string>
+#include <list>
+#include <unordered_map>
+
+#include "cache.h"
+
+using namespace std;
+
+// estimated bookkeeping per entry: list node, hash node, bucket
+static const size_t ENTRYOVERHEAD = 96;
+
+
+// constructor
+resultcache::resultcache(size_t budget)
+{
+	Budget = budget;
+	Bytes = 0;
+	Hits = 0;
+	Misses = 0;
+}
+
+
+//
+// _entrybytes
+//
+// Bytes charged against the budget for an entry: its key (held by both
+// the list and the hash table), its result and the bookkeeping.
+//
+size_t resultcache::_entrybytes(const ENTRY& entry)
+{
+	return 2 * entry.Key.size() + entry.Result.size() + ENTRYOVERHEAD;
+}
+
+
+//
+// _erase
+//
+// Removes an entry from the cache.
+//
+void resultcache::_erase(list<ENTRY>::iterator entry)
+{
+	Bytes -= _entrybytes(*entry);
+	Lookup.erase(entry->Key);
+	Entries.erase(entry);
+}
+
+
+//
+// _trim
+//
+// Evicts least recently used entries until the cache fits its budget.
+//
+void resultcache::_trim()
+{
+	while (Bytes > Budget && !Entries.empty())
+		_erase(prev(Entries.end()));
+}
+
+
+//
+// lookup
+//
+// Finds the result cached for key, computed at the given table version.
+// Returns true and fills in result on a hit (the entry becomes the most
+// recently used), false on a miss.  An entry from an older version is
+// stale and is dropped.
+//
+bool resultcache::lookup(const string& key, uint64_t version, string& result)
+{
+	unordered_map<string, list<ENTRY>::iterator>::iterator found = Lookup.find(key);
+	
+	if (found == Lookup.end())
+	{
+		Misses++;
+		return false;
+	}
+	
+	list<ENTRY>::iterator entry = found->second;
+	
+	if (entry->Version != version)
+	{
+		_erase(entry);
+		Misses++;
+		return false;
+	}
+	
+	Entries.splice(Entries.begin(), Entries, entry);
+	result = entry->Result;
+	Hits++;
+	
+	return true;
+}
+
+
+//
+// insert
+//
+// Caches the result of key as computed at the given table version,
+// replacing any older result.  A result bigger than the whole budget is
+// not cached.
+//
+void resultcache::insert(const string& key, uint64_t version, const string& result)
+{
+	unordered_map<string, list<ENTRY>::iterator>::iterator found = Lookup.find(key);
+	
+	if (found != Lookup.end())
+		_erase(found->second);
+	
+	ENTRY entry;
+	entry.Key = key;
+	entry.Result = result;
+	entry.Version = version;
+	
+	if (_entrybytes(entry) > Budget)
+		return;
+	
+	Entries.push_front(entry);
+	Lookup[key] = Entries.begin();
+	Bytes += _entrybytes(entry);
+	
+	_trim();
+}
+
+
+//
+// clear
+//
+// Empties the cache; the hit and miss counts are kept.
+//
+void resultcache::clear()
+{
+	Entries.clear();
+	Lookup.clear();
+	Bytes = 0;
+}
+
+
+//
+// setbudget
+//
+// Changes the byte budget, evicting entries if the cache no longer fits.
+//
+void resultcache::setbudget(size_t budget)
+{
+	Budget = budget;
+	_trim();
+}
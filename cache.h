@@ -0,0 +1,62 @@
+/*cache.h*/
+
+// Query result cache for myDB project
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <list>
+#include <unordered_map>
+#include <cstdint>
+
+using namespace std;
+
+//
+// resultcache
+//
+// LRU cache of query results (the text a query outputs), keyed by the
+// normalized query.  Each result is stamped with the table version it
+// was computed from; a lookup with a newer version finds it stale and
+// drops it, so a write only has to bump the version.  Results are
+// evicted least recently used first to keep the total size within the
+// byte budget; a budget of 0 disables the cache.
+//
+class resultcache
+{
+private:
+	struct ENTRY
+	{
+		string Key;
+		string Result;
+		uint64_t Version;
+	};
+	
+	list<ENTRY> Entries; // most recently used first
+	unordered_map<string, list<ENTRY>::iterator> Lookup;
+	size_t Budget;
+	size_t Bytes;
+	uint64_t Hits;
+	uint64_t Misses;
+	
+	static size_t _entrybytes(const ENTRY& entry);
+	void _erase(list<ENTRY>::iterator entry);
+	void _trim();
+	
+public:
+	// default budget of 16 MB
+	static const size_t DEFAULTBUDGET = 16 * 1024 * 1024;
+	
+	resultcache(size_t budget = DEFAULTBUDGET);
+	
+	bool lookup(const string& key, uint64_t version, string& result);
+	void insert(const string& key, uint64_t version, const string& result);
+	void clear();
+	void setbudget(size_t budget);
+	
+	size_t budget() const { return Budget; }
+	size_t bytes() const { return Bytes; }
+	size_t size() const { return Lookup.size(); }
+	uint64_t hits() const { return Hits; }
+	uint64_t misses() const { return Misses; }
+};
@@ -0,0 +1,529 @@
+/*columnfile.cpp*/
+
+// Columnar sidecar files for myDB project
+//
+// A column file "<table>.<column>.col" holds one column of every record
+// of the .data file, in record order.  Layout (native byte order):
+//
+//   header      COLUMNHEADER below, padded to HEADERSIZE bytes
+//   per record  uint8 value length (0 if the record is deleted),
+//               value bytes padded with spaces to the column width
+//
+// Like an index file, the header records the .data file's size and
+// modification time; if either has changed since the file was written
+// (or last restamped), the file is stale and is rebuilt.
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "columnfile.h"
+#include "parallel.h"
+#include "stats.h"
+
+using namespace std;
+
+static const char COLUMNMAGIC[8] = {'m', 'y', 'D', 'B', 'c', 'o', 'l', '1'};
+
+struct COLUMNHEADER
+{
+	char Magic[8];
+	int64_t DataSize;      // size of the .data file when written
+	int64_t DataMtimeSec;  // modification time of the .data file when written
+	int64_t DataMtimeNsec;
+	int64_t NumRecords;
+	int64_t RecordSize;    // record size of the .data file
+	int32_t Column;        // 0-based column the file holds
+	int32_t Width;         // bytes per value, after its length byte
+};
+
+static_assert(sizeof(COLUMNHEADER) <= columnfile::HEADERSIZE, "column file header too big");
+
+
+//
+// _datastamp
+//
+// Fills the header's size and modification time from the table's
+// .data file.  Returns false if the file can't be stat'ed.
+//
+static bool _datastamp(string tablename, COLUMNHEADER& header)
+{
+	struct stat info;
+	string filename = tablename + ".data";
+	
+	if (stat(filename.c_str(), &info) != 0)
+		return false;
+	
+	header.DataSize = info.st_size;
+	header.DataMtimeSec = info.st_mtim.tv_sec;
+	header.DataMtimeNsec = info.st_mtim.tv_nsec;
+	
+	return true;
+}
+
+
+//
+// ColumnFileName
+//
+// Returns the column file name for a table's column.
+//
+// Example: ColumnFileName("students", "email") returns "students.email.col".
+//
+string ColumnFileName(string tablename, string columnname)
+{
+	return tablename + "." + columnname + ".col";
+}
+
+
+// default constructor
+columnfile::columnfile()
+{
+	Fd = -1;
+	Mapping = nullptr;
+	MappedSize = 0;
+	Width = 0;
+	NumRecords = 0;
+	RecordSize = 0;
+}
+
+// destructor
+columnfile::~columnfile()
+{
+	close();
+}
+
+
+//
+// _map
+//
+// Maps MappedSize bytes of the open file for reading and writing.
+//
+bool columnfile::_map()
+{
+	void* mapping = mmap(nullptr, MappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, Fd, 0);
+	
+	if (mapping == MAP_FAILED)
+	{
+		Mapping = nullptr;
+		return false;
+	}
+	
+	Mapping = (char*) mapping;
+	return true;
+}
+
+
+//
+// open
+//
+// Opens and maps a column's file.  Returns false if there is no column
+// file, it is for a different column or table layout, or the .data
+// file changed after it was written.
+//
+bool columnfile::open(string tablename, string columnname, int column, const datatable& table)
+{
+	close();
+	
+	COLUMNHEADER current;
+	if (!_datastamp(tablename, current))
+		return false;
+	
+	string filename = ColumnFileName(tablename, columnname);
+	int fd = ::open(filename.c_str(), O_RDWR);
+	StatCount(COUNT_FILEOPENS, 1);
+	
+	if (fd < 0)
+		return false;
+	
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size < (off_t) HEADERSIZE)
+	{
+		::close(fd);
+		return false;
+	}
+	
+	COLUMNHEADER header;
+	if (pread(fd, &header, sizeof(header), 0) != (ssize_t) sizeof(header))
+	{
+		::close(fd);
+		return false;
+	}
+	
+	// check the file holds this column of every record of the current .data file
+	if (memcmp(header.Magic, COLUMNMAGIC, sizeof(COLUMNMAGIC)) != 0 ||
+		header.Column != column ||
+		header.RecordSize != table.recordsize() ||
+		header.NumRecords != table.numrecords() ||
+		header.Width < 0 || header.Width > MAXWIDTH ||
+		info.st_size != (off_t) (HEADERSIZE + header.NumRecords * (header.Width + 1)) ||
+		header.DataSize != current.DataSize ||
+		header.DataMtimeSec != current.DataMtimeSec ||
+		header.DataMtimeNsec != current.DataMtimeNsec)
+	{
+		::close(fd);
+		return false;
+	}
+	
+	Fd = fd;
+	MappedSize = info.st_size;
+	Width = header.Width;
+	NumRecords = header.NumRecords;
+	RecordSize = header.RecordSize;
+	FileName = filename;
+	
+	if (!_map())
+	{
+		close();
+		return false;
+	}
+	
+	return true;
+}
+
+
+//
+// close
+//
+// Unmaps and closes the column file, if one is open.  Pass true to
+// also remove the file, when it can no longer be kept in sync.
+//
+void columnfile::close(bool remove)
+{
+	if (Mapping != nullptr)
+		munmap(Mapping, MappedSize);
+	
+	if (Fd >= 0)
+		::close(Fd);
+	
+	if (remove && !FileName.empty())
+		unlink(FileName.c_str());
+	
+	Fd = -1;
+	Mapping = nullptr;
+	MappedSize = 0;
+	Width = 0;
+	NumRecords = 0;
+	FileName.clear();
+}
+
+
+//
+// erase
+//
+// Marks the record at the given .data file position deleted.  Returns
+// false if there is no such record.
+//
+bool columnfile::erase(streamoff pos)
+{
+	streamoff rec = pos / RecordSize;
+	
+	if (Mapping == nullptr || rec < 0 || rec >= NumRecords)
+		return false;
+	
+	Mapping[HEADERSIZE + rec * (Width + 1)] = 0;
+	return true;
+}
+
+
+//
+// append
+//
+// Adds one value per new record, just appended to the .data file, with
+// a single write.  Returns false (and adds nothing) if a value is wider
+// than the column, in which case the file can't be kept in sync.  If the
+// file can't be remapped after the write, it is closed and removed.
+//
+bool columnfile::append(const vector<string>& values)
+{
+	if (Mapping == nullptr)
+		return false;
+	
+	string slots;
+	slots.reserve(values.size() * (Width + 1));
+	
+	for (size_t i = 0; i < values.size(); i++)
+	{
+		if (values[i].empty() || values[i].size() > (size_t) Width)
+			return false;
+		
+		slots += (char) values[i].size();
+		slots += values[i];
+		slots.append(Width - values[i].size(), ' ');
+	}
+	
+	if (pwrite(Fd, slots.data(), slots.size(), MappedSize) != (ssize_t) slots.size())
+		return false;
+	
+	// map the longer file, and count the new records in the header
+	munmap(Mapping, MappedSize);
+	MappedSize += slots.size();
+	NumRecords += values.size();
+	
+	// the values are in the file but the header can't count them, so the
+	// file is out of sync for good: drop it, scans read the .data file
+	if (!_map())
+	{
+		close(true);
+		return false;
+	}
+	
+	int64_t numrecords = NumRecords;
+	memcpy(Mapping + offsetof(COLUMNHEADER, NumRecords), &numrecords, sizeof(int64_t));
+	
+	return true;
+}
+
+
+//
+// restamp
+//
+// Records that the column file is in sync with the .data file as it is
+// now, after writes have been applied to both.  Returns false if the
+// .data file can't be stat'ed.
+//
+bool columnfile::restamp(string tablename)
+{
+	COLUMNHEADER header;
+	
+	if (Mapping == nullptr || !_datastamp(tablename, header))
+		return false;
+	
+	memcpy(Mapping + offsetof(COLUMNHEADER, DataSize), &header.DataSize, 3 * sizeof(int64_t));
+	return true;
+}
+
+
+//
+// BuildColumnFiles
+//
+// Writes the column file of each given column (0-based, named by
+// columnNames) from the .data file: one pass to find each column's
+// width, one to write the values.  A column with a value wider than
+// MAXWIDTH gets no file.  Each file is written under a temporary name
+// and renamed into place.  Returns false if a file couldn't be written.
+//
+bool BuildColumnFiles(const datatable& table, string tablename, const vector<string>& columnNames, const vector<int>& columns)
+{
+	streamoff numrecords = table.numrecords();
+	streamoff recordsize = table.recordsize();
+	vector<fieldview> fields(table.numcolumns());
+	vector<int> widths(columns.size(), 1);
+	recordpin pin;
+	
+	StatCount(COUNT_BYTESREAD, 2 * numrecords * recordsize);
+	
+	// find the widest value of each column, skipping deleted records...
+	for (streamoff pos = 0; pos < numrecords * recordsize; pos += recordsize)
+	{
+		if (*pin.at(table, pos) == '.')
+			continue;
+		
+		table.columns(pos, &fields[0]);
+		
+		for (size_t i = 0; i < columns.size(); i++)
+			widths[i] = max(widths[i], (int) fields[columns[i]].Length);
+	}
+	
+	COLUMNHEADER header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.Magic, COLUMNMAGIC, sizeof(COLUMNMAGIC));
+	header.NumRecords = numrecords;
+	header.RecordSize = recordsize;
+	
+	if (!_datastamp(tablename, header))
+		return false;
+	
+	// open a file for each column that fits...
+	vector<ofstream> outs(columns.size());
+	vector<string> slots(columns.size());
+	bool ok = true;
+	
+	for (size_t i = 0; i < columns.size(); i++)
+	{
+		if (widths[i] > columnfile::MAXWIDTH)
+			continue;
+		
+		outs[i].open(ColumnFileName(tablename, columnNames[i]) + ".tmp", ios::out | ios::binary | ios::trunc);
+		StatCount(COUNT_FILEOPENS, 1);
+		
+		header.Column = columns[i];
+		header.Width = widths[i];
+		
+		char padded[columnfile::HEADERSIZE] = {0};
+		memcpy(padded, &header, sizeof(header));
+		outs[i].write(padded, sizeof(padded));
+		
+		slots[i].resize(widths[i] + 1);
+	}
+	
+	// ...and write every record's value to each
+	for (streamoff pos = 0; pos < numrecords * recordsize; pos += recordsize)
+	{
+		bool deleted = (*pin.at(table, pos) == '.');
+		
+		if (!deleted)
+			table.columns(pos, &fields[0]);
+		
+		for (size_t i = 0; i < columns.size(); i++)
+		{
+			if (!outs[i].is_open())
+				continue;
+			
+			string& slot = slots[i];
+			size_t length = deleted ? 0 : fields[columns[i]].Length;
+			
+			slot.assign(slot.size(), ' ');
+			slot[0] = (char) length;
+			if (length > 0)
+				memcpy(&slot[1], fields[columns[i]].Data, length);
+			
+			outs[i].write(slot.data(), slot.size());
+		}
+	}
+	
+	for (size_t i = 0; i < columns.size(); i++)
+	{
+		if (!outs[i].is_open())
+			continue;
+		
+		string filename = ColumnFileName(tablename, columnNames[i]);
+		string tempname = filename + ".tmp";
+		
+		outs[i].close();
+		
+		if (!outs[i].good() || rename(tempname.c_str(), filename.c_str()) != 0)
+		{
+			remove(tempname.c_str());
+			ok = false;
+		}
+	}
+	
+	return ok;
+}
+
+
+//
+// _columnscanrange
+//
+// ColumnScan over records [firstRecord, lastRecord), see below.
+//
+static vector<streamoff> _columnscanrange(const columnfile& file, const predicate& pred, streamoff firstRecord, streamoff lastRecord)
+{
+	vector<streamoff> matches;
+	streamoff recordsize = file.recordsize();
+	
+	for (streamoff rec = firstRecord; rec < lastRecord; rec++)
+	{
+		const unsigned char* slot = file.slot(rec);
+		
+		// skip deleted records
+		if (slot[0] == 0)
+			continue;
+		
+		if (pred.matches((const char*) slot + 1, slot[0]))
+			matches.push_back(rec * recordsize);
+	}
+	
+	return matches;
+}
+
+
+//
+// ColumnScan
+//
+// Same as LinearSearch, but reads the values from a column file instead
+// of the whole records of the .data file: returns the .data file
+// positions of the records whose value matches the predicate, in file
+// order.  The records are split across numThreads threads like
+// ParallelScanColumn.
+//
+vector<streamoff> ColumnScan(const columnfile& file, const predicate& pred, int numThreads)
+{
+	scopedtimer timer(TIME_LINEARSEARCH);
+	
+	StatCount(COUNT_BYTESREAD, file.numrecords() * (file.width() + 1));
+	
+	return SplitRecords(file.numrecords(), numThreads, vector<streamoff>(),
+		[&file, &pred](streamoff first, streamoff last)
+		{
+			return _columnscanrange(file, pred, first, last);
+		},
+		AppendRange);
+}
+
+
+//
+// _columnaggregaterange
+//
+// ColumnAggregate over records [firstRecord, lastRecord), see below.
+//
+static aggregate _columnaggregaterange(const columnfile& file, const aggregate& empty, streamoff firstRecord, streamoff lastRecord)
+{
+	aggregate result = empty;
+	
+	for (streamoff rec = firstRecord; rec < lastRecord; rec++)
+	{
+		const unsigned char* slot = file.slot(rec);
+		
+		// skip deleted records
+		if (slot[0] != 0)
+			result.add((const char*) slot + 1, slot[0]);
+	}
+	
+	return result;
+}
+
+
+//
+// ColumnAggregate
+//
+// Same as ScanAggregate, but reads the values from a column file; for
+// count(*), any column's file will do.
+//
+aggregate ColumnAggregate(const columnfile& file, const aggregate& empty, int numThreads)
+{
+	StatCount(COUNT_BYTESREAD, file.numrecords() * (file.width() + 1));
+	
+	return SplitRecords(file.numrecords(), numThreads, empty,
+		[&file, &empty](streamoff first, streamoff last)
+		{
+			return _columnaggregaterange(file, empty, first, last);
+		},
+		[](aggregate& result, const aggregate& part)
+		{
+			result.merge(part);
+		});
+}
+
+
+//
+// ColumnAggregatePositions
+//
+// Same as AggregatePositions, but reads the values at the given .data
+// file positions from a column file.
+//
+void ColumnAggregatePositions(const columnfile& file, const vector<streamoff>& positions, aggregate& result)
+{
+	streamoff recordsize = file.recordsize();
+	
+	StatCount(COUNT_BYTESREAD, positions.size() * (file.width() + 1));
+	
+	for (size_t i = 0; i < positions.size(); i++)
+	{
+		const unsigned char* slot = file.slot(positions[i] / recordsize);
+		
+		if (slot[0] != 0)
+			result.add((const char*) slot + 1, slot[0]);
+	}
+}
@@ -0,0 +1,88 @@
+/*columnfile.h*/
+
+// Columnar sidecar files for myDB project
+
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "aggregate.h"
+#include "scan.h"
+#include "table.h"
+
+using namespace std;
+
+//
+// columnfile
+//
+// One column of a table stored on its own, "<table>.<column>.col", so a
+// scan of the column reads just its values instead of whole records.
+// Every value takes the same slot, a length byte and then the value
+// padded to the column's widest value, so record r's value is at a
+// fixed offset and can be deleted or added in place.  A length of 0
+// marks a deleted record.
+//
+// The file is mapped shared and kept in sync with the .data file by the
+// writes (erase, append); restamp records that it is, see indexfile.cpp
+// for the stamp.
+//
+class columnfile
+{
+private:
+	int Fd;
+	char* Mapping;        // header, then NumRecords slots
+	size_t MappedSize;
+	int Width;            // bytes per value, after its length byte
+	streamoff NumRecords;
+	streamoff RecordSize; // of the .data file, to turn positions into record #s
+	string FileName;
+	
+	// no copies, the mapping is owned by exactly one column file
+	columnfile(const columnfile& other);
+	columnfile& operator=(const columnfile& other);
+	
+	bool _map();
+
+public:
+	// widest value a column file holds
+	static const int MAXWIDTH = 255;
+	
+	// bytes before the first slot
+	static const size_t HEADERSIZE = 64;
+	
+	columnfile();
+	virtual ~columnfile();
+	
+	bool open(string tablename, string columnname, int column, const datatable& table);
+	void close(bool remove = false);
+	
+	// good function (true if a column file is open)
+	bool good() const { return Fd >= 0; }
+	
+	int width() const { return Width; }
+	streamoff numrecords() const { return NumRecords; }
+	streamoff recordsize() const { return RecordSize; }
+	
+	// slot function (length byte and value of record # rec)
+	const unsigned char* slot(streamoff rec) const
+	{
+		return (const unsigned char*) Mapping + HEADERSIZE + rec * (Width + 1);
+	}
+	
+	bool erase(streamoff pos);
+	bool append(const vector<string>& values);
+	bool restamp(string tablename);
+};
+
+string ColumnFileName(string tablename, string columnname);
+
+bool BuildColumnFiles(const datatable& table, string tablename, const vector<string>& columnNames, const vector<int>& columns);
+
+vector<streamoff> ColumnScan(const columnfile& file, const predicate& pred, int numThreads);
+
+aggregate ColumnAggregate(const columnfile& file, const aggregate& empty, int numThreads);
+
+void ColumnAggregatePositions(const columnfile& file, const vector<streamoff>& positions, aggregate& result);
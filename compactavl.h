@@ -0,0 +1,653 @@
+/*compactavl.h*/
+
+// Cache-friendly AVL tree with array-stored nodes for myDB project
+
+#pragma once
+
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <cstdint>
+#include <stack>
+#include <string>
+#include <vector>
+#include <cassert>
+#include <utility>
+
+#include "frozen.h"
+#include "stats.h"
+
+using namespace std;
+
+//
+// compactkey
+//
+// A 16-byte string key.  Keys up to 15 chars are stored inline, longer
+// keys keep a pointer to their own heap copy.  Compares like string.
+//
+class compactkey
+{
+private:
+	static const uint8_t MAXINLINE = 15;
+	static const uint8_t HEAPTAG = 0xFF;
+	
+	// inline: Data holds the chars, Tag is the length
+	// heap:   Data holds a char* and a uint32 length, Tag is HEAPTAG
+	char Data[15];
+	uint8_t Tag;
+	
+	void _set(const char* chars, size_t length)
+	{
+		if (length <= MAXINLINE)
+		{
+			memcpy(Data, chars, length);
+			Tag = (uint8_t) length;
+		}
+		else
+		{
+			char* heap = new char[length];
+			uint32_t heaplength = (uint32_t) length;
+			
+			memcpy(heap, chars, length);
+			memcpy(Data, &heap, sizeof(char*));
+			memcpy(Data + sizeof(char*), &heaplength, sizeof(uint32_t));
+			Tag = HEAPTAG;
+		}
+	}
+	
+	void _free()
+	{
+		if (Tag == HEAPTAG)
+			delete[] data();
+		Tag = 0;
+	}
+	
+public:
+	compactkey()
+	{
+		memset(Data, 0, sizeof(Data));
+		Tag = 0;
+	}
+	
+	compactkey(const string& key)
+	{
+		_set(key.data(), key.size());
+	}
+	
+	compactkey(const compactkey& other)
+	{
+		_set(other.data(), other.size());
+	}
+	
+	compactkey(compactkey&& other) noexcept
+	{
+		memcpy(Data, other.Data, sizeof(Data));
+		Tag = other.Tag;
+		other.Tag = 0;
+	}
+	
+	compactkey& operator=(const compactkey& other)
+	{
+		if (this != &other)
+		{
+			_free();
+			_set(other.data(), other.size());
+		}
+		
+		return *this;
+	}
+	
+	compactkey& operator=(compactkey&& other) noexcept
+	{
+		if (this != &other)
+		{
+			_free();
+			memcpy(Data, other.Data, sizeof(Data));
+			Tag = other.Tag;
+			other.Tag = 0;
+		}
+		
+		return *this;
+	}
+	
+	~compactkey()
+	{
+		_free();
+	}
+	
+	// data function (pointer to the key's chars)
+	const char* data() const
+	{
+		if (Tag != HEAPTAG)
+			return Data;
+		
+		char* heap;
+		memcpy(&heap, Data, sizeof(char*));
+		return heap;
+	}
+	
+	// size function (# of chars in the key)
+	size_t size() const
+	{
+		if (Tag != HEAPTAG)
+			return Tag;
+		
+		uint32_t heaplength;
+		memcpy(&heaplength, Data + sizeof(char*), sizeof(uint32_t));
+		return heaplength;
+	}
+	
+	// compare function (<0, 0, >0 like string::compare)
+	int compare(const char* chars, size_t length) const
+	{
+		size_t mylength = size();
+		int result = memcmp(data(), chars, std::min(mylength, length));
+		
+		if (result != 0)
+			return result;
+		else if (mylength == length)
+			return 0;
+		else
+			return (mylength < length) ? -1 : 1;
+	}
+	
+	string str() const
+	{
+		return string(data(), size());
+	}
+};
+
+
+//
+// compactavltree
+//
+// Same interface as avltree<string, TValue>, but nodes live in one
+// contiguous array and link to each other by 32-bit index instead of
+// pointer, heights are 8 bits, and keys are compactkeys.  Nodes are
+// smaller and neighbours in the array are often neighbours in the tree,
+// so searches touch fewer cache lines.
+//
+template<typename TValue>
+class compactavltree
+{
+private:
+	static const uint32_t NIL = 0xFFFFFFFF;
+	
+	struct NODE
+	{
+		compactkey Key;
+		TValue Value;
+		uint32_t Left;   // index of left child in Nodes, NIL if none
+		uint32_t Right;  // index of right child in Nodes, NIL if none
+		int8_t Height;
+	};
+	
+	vector<NODE> Nodes;
+	uint32_t Root;
+	uint32_t FreeList; // erased slots, chained through Left
+	int Size;
+	
+	// _height private function to get height of subtree, -1 if no node
+	int _height(uint32_t cur) const
+	{
+		return (cur == NIL) ? -1 : Nodes[cur].Height;
+	}
+	
+	void _updateheight(uint32_t cur)
+	{
+		Nodes[cur].Height = (int8_t) (1 + std::max(_height(Nodes[cur].Left), _height(Nodes[cur].Right)));
+	}
+	
+	// _newnode private function to take a free slot (or a new one) for a node
+	uint32_t _newnode(const string& key, const TValue& value)
+	{
+		uint32_t cur;
+		
+		if (FreeList != NIL)
+		{
+			cur = FreeList;
+			FreeList = Nodes[cur].Left;
+		}
+		else
+		{
+			assert(Nodes.size() < NIL);
+			Nodes.push_back(NODE());
+			cur = (uint32_t) Nodes.size() - 1;
+		}
+		
+		Nodes[cur].Key = compactkey(key);
+		Nodes[cur].Value = value;
+		Nodes[cur].Left = NIL;
+		Nodes[cur].Right = NIL;
+		Nodes[cur].Height = 0;
+		
+		return cur;
+	}
+	
+	// _freenode private function to put a node's slot on the free list
+	void _freenode(uint32_t cur)
+	{
+		Nodes[cur].Key = compactkey();
+		Nodes[cur].Value = TValue();
+		Nodes[cur].Left = FreeList;
+		FreeList = cur;
+	}
+	
+	// _rightrotate private function, returns the subtree's new root
+	uint32_t _rightrotate(uint32_t cur)
+	{
+		StatCount(COUNT_ROTATIONS, 1);
+		
+		uint32_t left = Nodes[cur].Left;
+		
+		Nodes[cur].Left = Nodes[left].Right;
+		Nodes[left].Right = cur;
+		
+		_updateheight(cur);
+		_updateheight(left);
+		
+		return left;
+	}
+	
+	// _leftrotate private function, returns the subtree's new root
+	uint32_t _leftrotate(uint32_t cur)
+	{
+		StatCount(COUNT_ROTATIONS, 1);
+		
+		uint32_t right = Nodes[cur].Right;
+		
+		Nodes[cur].Right = Nodes[right].Left;
+		Nodes[right].Left = cur;
+		
+		_updateheight(cur);
+		_updateheight(right);
+		
+		return right;
+	}
+	
+	// _rebalance private function to fix height/AVL status of a subtree
+	// after one of its children changed, returns the subtree's new root
+	uint32_t _rebalance(uint32_t cur)
+	{
+		_updateheight(cur);
+		
+		int balance = _height(Nodes[cur].Left) - _height(Nodes[cur].Right);
+		
+		if (balance > 1)
+		{
+			uint32_t left = Nodes[cur].Left;
+			if (_height(Nodes[left].Left) < _height(Nodes[left].Right))
+				Nodes[cur].Left = _leftrotate(left);
+			return _rightrotate(cur);
+		}
+		else if (balance < -1)
+		{
+			uint32_t right = Nodes[cur].Right;
+			if (_height(Nodes[right].Right) < _height(Nodes[right].Left))
+				Nodes[cur].Right = _rightrotate(right);
+			return _leftrotate(cur);
+		}
+		
+		return cur;
+	}
+	
+	// _insert private function, returns the subtree's new root
+	// (Nodes may grow during the call, so no references are held across it)
+	uint32_t _insert(uint32_t cur, const string& key, const TValue& value)
+	{
+		if (cur == NIL)
+		{
+			Size++;
+			return _newnode(key, value);
+		}
+		
+		int result = Nodes[cur].Key.compare(key.data(), key.size());
+		
+		if (result == 0)
+			return cur; // already in tree
+		else if (result > 0)
+		{
+			uint32_t left = _insert(Nodes[cur].Left, key, value);
+			Nodes[cur].Left = left;
+		}
+		else
+		{
+			uint32_t right = _insert(Nodes[cur].Right, key, value);
+			Nodes[cur].Right = right;
+		}
+		
+		return _rebalance(cur);
+	}
+	
+	// _erasemin private function to unlink the smallest node of a subtree
+	// into minNode, returns the subtree's new root
+	uint32_t _erasemin(uint32_t cur, uint32_t& minNode)
+	{
+		if (Nodes[cur].Left == NIL)
+		{
+			minNode = cur;
+			return Nodes[cur].Right;
+		}
+		
+		Nodes[cur].Left = _erasemin(Nodes[cur].Left, minNode);
+		
+		return _rebalance(cur);
+	}
+	
+	// _erase private function, returns the subtree's new root
+	uint32_t _erase(uint32_t cur, const string& key, bool& erased)
+	{
+		if (cur == NIL)
+			return NIL;
+		
+		int result = Nodes[cur].Key.compare(key.data(), key.size());
+		
+		if (result > 0)
+			Nodes[cur].Left = _erase(Nodes[cur].Left, key, erased);
+		else if (result < 0)
+			Nodes[cur].Right = _erase(Nodes[cur].Right, key, erased);
+		else
+		{
+			uint32_t left = Nodes[cur].Left;
+			uint32_t right = Nodes[cur].Right;
+			
+			erased = true;
+			Size--;
+			_freenode(cur);
+			
+			if (left == NIL)
+				return right;
+			if (right == NIL)
+				return left;
+			
+			// replace with the inorder successor
+			uint32_t succ;
+			right = _erasemin(right, succ);
+			Nodes[succ].Left = left;
+			Nodes[succ].Right = right;
+			
+			return _rebalance(succ);
+		}
+		
+		return _rebalance(cur);
+	}
+	
+	// _buildtree private function to build a balanced subtree from sorted keys/values
+	uint32_t _buildtree(const std::vector<string>& keys, const std::vector<TValue>& values,
+						size_t low, size_t high)
+	{
+		if (low >= high)
+			return NIL;
+		
+		size_t mid = low + (high - low) / 2;
+		uint32_t cur = _newnode(keys[mid], values[mid]);
+		
+		uint32_t left = _buildtree(keys, values, low, mid);
+		uint32_t right = _buildtree(keys, values, mid + 1, high);
+		
+		Nodes[cur].Left = left;
+		Nodes[cur].Right = right;
+		_updateheight(cur);
+		Size++;
+		
+		return cur;
+	}
+	
+	void _inorder_keys(uint32_t cur, std::vector<string>& vect) const
+	{
+		if (cur == NIL)
+			return;
+		
+		_inorder_keys(Nodes[cur].Left, vect);
+		vect.push_back(Nodes[cur].Key.str());
+		_inorder_keys(Nodes[cur].Right, vect);
+	}
+	
+	void _inorder_values(uint32_t cur, std::vector<TValue>& vect) const
+	{
+		if (cur == NIL)
+			return;
+		
+		_inorder_values(Nodes[cur].Left, vect);
+		vect.push_back(Nodes[cur].Value);
+		_inorder_values(Nodes[cur].Right, vect);
+	}
+	
+public:
+	// iterator class (inorder walk from a starting key, see begin/lower_bound/upper_bound)
+	class iterator
+	{
+	private:
+		compactavltree* Tree;
+		stack<uint32_t> Path; // nodes left to visit on the walk, current node on top
+		
+		friend class compactavltree;
+		
+	public:
+		bool done() const
+		{
+			return Path.empty();
+		}
+		
+		string key() const
+		{
+			return Tree->Nodes[Path.top()].Key.str();
+		}
+		
+		TValue& value() const
+		{
+			return Tree->Nodes[Path.top()].Value;
+		}
+		
+		void next()
+		{
+			uint32_t cur = Tree->Nodes[Path.top()].Right;
+			Path.pop();
+			
+			while (cur != NIL)
+			{
+				Path.push(cur);
+				cur = Tree->Nodes[cur].Left;
+			}
+		}
+	};
+	
+	// default constructor
+	compactavltree()
+	{
+		Root = NIL;
+		FreeList = NIL;
+		Size = 0;
+	}
+	
+	int size() const
+	{
+		return Size;
+	}
+	
+	int height() const
+	{
+		return _height(Root);
+	}
+	
+	// memory function (bytes held by the node array, not counting long keys)
+	size_t memory() const
+	{
+		return Nodes.capacity() * sizeof(NODE);
+	}
+	
+	void clear()
+	{
+		Nodes.clear();
+		Root = NIL;
+		FreeList = NIL;
+		Size = 0;
+	}
+	
+	TValue* search(const string& key)
+	{
+		uint32_t cur = Root;
+		uint64_t visited = 0;
+		
+		while (cur != NIL)
+		{
+			visited++;
+			
+			int result = Nodes[cur].Key.compare(key.data(), key.size());
+			
+			if (result == 0)
+				break;
+			
+			cur = (result > 0) ? Nodes[cur].Left : Nodes[cur].Right;
+		}
+		
+		StatCount(COUNT_SEARCHES, 1);
+		StatCount(COUNT_NODESVISITED, visited);
+		
+		return (cur != NIL) ? &Nodes[cur].Value : nullptr;
+	}
+	
+	void insert(const string& key, const TValue& value)
+	{
+		Root = _insert(Root, key, value);
+	}
+	
+	bool erase(const string& key)
+	{
+		bool erased = false;
+		
+		Root = _erase(Root, key, erased);
+		
+		return erased;
+	}
+	
+	// build function (replace tree with a balanced tree of sorted keys/values)
+	void build(const std::vector<string>& keys, const std::vector<TValue>& values)
+	{
+		assert(keys.size() == values.size());
+		
+		clear();
+		Nodes.reserve(keys.size());
+		
+		Root = _buildtree(keys, values, 0, keys.size());
+	}
+	
+	iterator begin()
+	{
+		iterator it;
+		it.Tree = this;
+		
+		for (uint32_t cur = Root; cur != NIL; cur = Nodes[cur].Left)
+			it.Path.push(cur);
+		
+		return it;
+	}
+	
+	// first function (value of the smallest key, the leftmost node, or
+	// null if the tree is empty)
+	TValue* first()
+	{
+		uint32_t cur = Root;
+		
+		if (cur == NIL)
+			return nullptr;
+		
+		while (Nodes[cur].Left != NIL)
+			cur = Nodes[cur].Left;
+		
+		return &Nodes[cur].Value;
+	}
+	
+	// last function (value of the largest key, the rightmost node, or
+	// null if the tree is empty)
+	TValue* last()
+	{
+		uint32_t cur = Root;
+		
+		if (cur == NIL)
+			return nullptr;
+		
+		while (Nodes[cur].Right != NIL)
+			cur = Nodes[cur].Right;
+		
+		return &Nodes[cur].Value;
+	}
+	
+	iterator lower_bound(const string& key)
+	{
+		iterator it;
+		it.Tree = this;
+		uint32_t cur = Root;
+		uint64_t visited = 0;
+		
+		while (cur != NIL)
+		{
+			visited++;
+			
+			if (Nodes[cur].Key.compare(key.data(), key.size()) < 0)
+				cur = Nodes[cur].Right;
+			else
+			{
+				it.Path.push(cur);
+				cur = Nodes[cur].Left;
+			}
+		}
+		
+		StatCount(COUNT_SEARCHES, 1);
+		StatCount(COUNT_NODESVISITED, visited);
+		
+		return it;
+	}
+	
+	iterator upper_bound(const string& key)
+	{
+		iterator it;
+		it.Tree = this;
+		uint32_t cur = Root;
+		uint64_t visited = 0;
+		
+		while (cur != NIL)
+		{
+			visited++;
+			
+			if (Nodes[cur].Key.compare(key.data(), key.size()) > 0)
+			{
+				it.Path.push(cur);
+				cur = Nodes[cur].Left;
+			}
+			else
+				cur = Nodes[cur].Right;
+		}
+		
+		StatCount(COUNT_SEARCHES, 1);
+		StatCount(COUNT_NODESVISITED, visited);
+		
+		return it;
+	}
+	
+	// freeze function (read-only snapshot of the tree, the same frozen
+	// tree an avltree<string, TValue> freezes to)
+	frozentree<string, TValue> freeze()
+	{
+		return frozentree<string, TValue>(inorder_keys(), inorder_values());
+	}
+	
+	std::vector<string> inorder_keys() const
+	{
+		std::vector<string> keysVect;
+		
+		_inorder_keys(Root, keysVect);
+		
+		return keysVect;
+	}
+	
+	std::vector<TValue> inorder_values() const
+	{
+		std::vector<TValue> valuesVect;
+		
+		_inorder_values(Root, valuesVect);
+		
+		return valuesVect;
+	}
+};
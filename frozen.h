@@ -0,0 +1,343 @@
+/*frozen.h*/
+
+// Read-only frozen snapshot of an avltree for myDB project
+
+#pragma once
+
+#include <iostream>
+#include <cstdlib>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "stats.h"
+
+using namespace std;
+
+//
+// cachealigned
+//
+// std::vector allocator that starts every array on a cache line (64 bytes).
+//
+template<typename T>
+struct cachealigned
+{
+	typedef T value_type;
+	
+	cachealigned() {}
+	
+	template<typename U>
+	cachealigned(const cachealigned<U>&) {}
+	
+	T* allocate(size_t n)
+	{
+		void* memory = nullptr;
+		
+		if (posix_memalign(&memory, 64, max(n * sizeof(T), (size_t) 64)) != 0)
+			throw bad_alloc();
+		
+		return static_cast<T*>(memory);
+	}
+	
+	void deallocate(T* memory, size_t)
+	{
+		free(memory);
+	}
+};
+
+template<typename T, typename U>
+bool operator==(const cachealigned<T>&, const cachealigned<U>&) { return true; }
+
+template<typename T, typename U>
+bool operator!=(const cachealigned<T>&, const cachealigned<U>&) { return false; }
+
+
+//
+// frozentree
+//
+// An immutable copy of a tree's keys and values, laid out for fast
+// searching instead of for updates:
+//
+//  - Keys/Values hold the pairs in sorted order, so range walks read
+//    consecutive memory.
+//  - Each key is also reduced to a 64-bit ordinal that sorts the same
+//    way (a number's bits with the sign flipped; for strings, 8 bytes
+//    after the prefix every key shares).  The ordinals are stored in
+//    Eytzinger (BFS) order: the root at 1, the children of k at 2k and
+//    2k+1, 8 to a cache line.  A search walks down that array with one
+//    integer compare and no branch per level, prefetching the 16 nodes
+//    4 levels further down as it goes, so the cache misses overlap.
+//    Keys with equal ordinals (long shared string prefixes) are then
+//    told apart by a binary search over just that run of Keys.
+//
+// Made by avltree::freeze(); has the same search/iterator interface.
+//
+template<typename TKey, typename TValue>
+class frozentree
+{
+private:
+	vector<TKey> Keys;     // sorted keys
+	vector<TValue> Values; // values, same order as Keys
+	vector<uint64_t, cachealigned<uint64_t>> Eytzinger; // key ordinals in BFS order, from index 1
+	vector<uint32_t, cachealigned<uint32_t>> Rank;      // position in Keys of each Eytzinger entry
+	string Shared;         // prefix shared by every string key
+	
+	// _ordinal private functions to map a key to its ordinal; returns
+	// false if the key sorts entirely before (below < 0) or after
+	// (below > 0) every key in the snapshot
+	bool _ordinal(const string& key, uint64_t& ordinal, int& below) const
+	{
+		int result = key.compare(0, Shared.size(), Shared);
+		
+		if (result != 0)
+		{
+			below = result;
+			return false;
+		}
+		
+		// next 8 bytes after the shared prefix, big-endian, 0 padded
+		ordinal = 0;
+		for (size_t i = 0; i < 8; i++)
+		{
+			size_t pos = Shared.size() + i;
+			ordinal = (ordinal << 8) | (pos < key.size() ? (unsigned char) key[pos] : 0);
+		}
+		
+		return true;
+	}
+	
+	bool _ordinal(double key, uint64_t& ordinal, int& below) const
+	{
+		// IEEE bits sort like the numbers once negatives are flipped;
+		// -0.0 == 0.0 but has the sign bit set, so make it +0.0 first
+		if (key == 0)
+			key = 0;
+		
+		memcpy(&ordinal, &key, sizeof(ordinal));
+		ordinal = (ordinal >> 63) ? ~ordinal : (ordinal | ((uint64_t) 1 << 63));
+		below = 0;
+		return true;
+	}
+	
+	template<typename TInt>
+	bool _ordinal(TInt key, uint64_t& ordinal, int& below) const
+	{
+		ordinal = (uint64_t) (int64_t) key ^ ((uint64_t) 1 << 63);
+		below = 0;
+		return true;
+	}
+	
+	// _sharedprefix private function to find the prefix every string key shares
+	void _sharedprefix(const vector<string>& keys)
+	{
+		if (!keys.empty())
+		{
+			// sorted, so the first and last keys share the least
+			const string& first = keys.front();
+			const string& last = keys.back();
+			size_t length = 0;
+			
+			while (length < first.size() && length < last.size() && first[length] == last[length])
+				length++;
+			
+			Shared = first.substr(0, length);
+		}
+	}
+	
+	template<typename T>
+	void _sharedprefix(const vector<T>&)
+	{
+	}
+	
+	// _layout private function to fill the Eytzinger arrays by an inorder
+	// walk of the implicit tree, returns the next sorted position to place
+	size_t _layout(size_t sortedPos, size_t k)
+	{
+		if (k < Eytzinger.size())
+		{
+			sortedPos = _layout(sortedPos, 2 * k);
+			
+			int below;
+			_ordinal(Keys[sortedPos], Eytzinger[k], below);
+			Rank[k] = (uint32_t) sortedPos;
+			
+			sortedPos = _layout(sortedPos + 1, 2 * k + 1);
+		}
+		
+		return sortedPos;
+	}
+	
+	// _firstatleast private function to find the sorted position of the
+	// first key whose ordinal is >= ordinal, Keys.size() if none
+	size_t _firstatleast(uint64_t ordinal) const
+	{
+		size_t n = Keys.size();
+		size_t k = 1;
+		const uint64_t* eytzinger = Eytzinger.data();
+		uint64_t visited = 0;
+		
+		while (k <= n)
+		{
+			visited++;
+			
+			// the 16 descendants 4 levels down fill two cache lines, fetch them now
+			if (k * 16 + 8 <= n)
+			{
+				__builtin_prefetch(eytzinger + k * 16);
+				__builtin_prefetch(eytzinger + k * 16 + 8);
+			}
+			
+			k = 2 * k + (eytzinger[k] < ordinal);
+		}
+		
+		// undo the right turns taken after the last left turn; the node
+		// we turned left at is the answer (0 if we never turned left)
+		k >>= __builtin_ffsll(~k);
+		
+		StatCount(COUNT_SEARCHES, 1);
+		StatCount(COUNT_NODESVISITED, visited);
+		
+		return (k == 0) ? n : Rank[k];
+	}
+	
+	// _lowerbound private function to find the sorted position of the
+	// first key >= key (or > key when strict), Keys.size() if none
+	size_t _lowerbound(const TKey& key, bool strict) const
+	{
+		uint64_t ordinal;
+		int below;
+		
+		if (!_ordinal(key, ordinal, below))
+			return (below < 0) ? 0 : Keys.size();
+		
+		// keys before the run of keys with this ordinal are all smaller,
+		// and usually the run's first key already settles it
+		size_t first = _firstatleast(ordinal);
+		
+		if (first == Keys.size() || (strict ? key < Keys[first] : !(Keys[first] < key)))
+			return first;
+		
+		// otherwise find the exact spot inside the run
+		size_t last = (ordinal == UINT64_MAX) ? Keys.size() : _firstatleast(ordinal + 1);
+		
+		if (strict)
+			return std::upper_bound(Keys.begin() + first, Keys.begin() + last, key) - Keys.begin();
+		else
+			return std::lower_bound(Keys.begin() + first, Keys.begin() + last, key) - Keys.begin();
+	}
+	
+public:
+	// iterator class (walk in key order from a starting position)
+	class iterator
+	{
+	private:
+		frozentree* Tree;
+		size_t Pos;
+		
+		friend class frozentree;
+		
+	public:
+		iterator()
+		{
+			Tree = nullptr;
+			Pos = 0;
+		}
+		
+		bool done() const
+		{
+			return Tree == nullptr || Pos >= Tree->Keys.size();
+		}
+		
+		const TKey& key() const
+		{
+			return Tree->Keys[Pos];
+		}
+		
+		TValue& value() const
+		{
+			return Tree->Values[Pos];
+		}
+		
+		void next()
+		{
+			Pos++;
+		}
+	};
+	
+	// default constructor (empty snapshot)
+	frozentree()
+	{
+		Eytzinger.resize(1);
+		Rank.resize(1);
+	}
+	
+	// constructor (snapshot of sorted keys/values, which are taken over)
+	frozentree(vector<TKey>&& keys, vector<TValue>&& values)
+		: Keys(std::move(keys)), Values(std::move(values))
+	{
+		Eytzinger.resize(Keys.size() + 1);
+		Rank.resize(Keys.size() + 1);
+		
+		_sharedprefix(Keys);
+		_layout(0, 1);
+	}
+	
+	int size() const
+	{
+		return (int) Keys.size();
+	}
+	
+	// search function (search snapshot for given key)
+	TValue* search(const TKey& key)
+	{
+		size_t pos = _lowerbound(key, false);
+		
+		if (pos < Keys.size() && !(key < Keys[pos]))
+			return &Values[pos];
+		else
+			return nullptr;
+	}
+	
+	// first function (value of the smallest key, null if empty)
+	TValue* first()
+	{
+		return Values.empty() ? nullptr : &Values.front();
+	}
+	
+	// last function (value of the largest key, null if empty)
+	TValue* last()
+	{
+		return Values.empty() ? nullptr : &Values.back();
+	}
+	
+	iterator begin()
+	{
+		iterator it;
+		it.Tree = this;
+		it.Pos = 0;
+		return it;
+	}
+	
+	// lower_bound function (iterator at the first key >= given key)
+	iterator lower_bound(const TKey& key)
+	{
+		iterator it;
+		it.Tree = this;
+		it.Pos = _lowerbound(key, false);
+		return it;
+	}
+	
+	// upper_bound function (iterator at the first key > given key)
+	iterator upper_bound(const TKey& key)
+	{
+		iterator it;
+		it.Tree = this;
+		it.Pos = _lowerbound(key, true);
+		return it;
+	}
+};
@@ -0,0 +1,481 @@
+/*gen.cpp*/
+
+// Synthetic table generator for myDB project
+//
+// Usage: gen.exe TABLENAME [--rows N] [--record-size N] [--threads N]
+//                [--seed N] [--column SPEC]...
+//
+// Writes TABLENAME.meta and TABLENAME.data in the same fixed-width
+// format as the sample tables: each record is its values separated by
+// spaces, a space, '.' padding up to the record size, and "\r\n".
+//
+// Each column is given as name:distribution, plus :1 to index it:
+//
+//   unique          0 .. rows-1, each once, in random order
+//   sorted          0 .. rows-1 in order
+//   reverse         rows-1 .. 0 in order
+//   uniform[=N]     random in 0 .. N-1 (N = rows by default)
+//   zipf[=S[/N]]    Zipfian ranks 1 .. N with exponent S (1.0 and
+//                   min(rows, 100000) by default), rank 1 most common
+//   text[=L]        L random lowercase letters (8 by default)
+//
+// e.g. gen.exe big --rows 100000000 --column id:unique:1
+//          --column city:zipf=1.2/500:1 --column score:uniform=1000
+//
+// The record size defaults to the widest possible record.  Records are
+// fixed width, so every block of rows has a known place in the file:
+// the blocks are formatted on all threads at once and written straight
+// to their offsets.  Values depend only on the seed, not on the # of
+// threads.
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+// rows formatted and written together
+static const int64_t BLOCKROWS = 65536;
+
+
+//
+// COLUMN
+//
+// A column to generate: its name, whether it is indexed, and how its
+// values are distributed.
+//
+enum distribution { DIST_UNIQUE, DIST_SORTED, DIST_REVERSE, DIST_UNIFORM, DIST_ZIPF, DIST_TEXT };
+
+struct COLUMN
+{
+	string Name;
+	bool Indexed;
+	distribution Dist;
+	int64_t Domain;       // uniform/zipf: # of distinct values, text: length
+	double Exponent;      // zipf: exponent
+	vector<double> Cdf;   // zipf: cumulative probability of ranks 1 .. Domain
+	int Width;            // widest value, in characters
+};
+
+
+//
+// _digits
+//
+// Returns the # of decimal digits of n (n >= 0).
+//
+static int _digits(int64_t n)
+{
+	int digits = 1;
+
+	while (n >= 10)
+	{
+		n /= 10;
+		digits++;
+	}
+
+	return digits;
+}
+
+
+//
+// _parsecolumn
+//
+// Parses a column spec (name:distribution[:1]) for a table of the given
+// # of rows.  Returns false if the spec is invalid.
+//
+static bool _parsecolumn(string spec, int64_t rows, COLUMN& column)
+{
+	vector<string> parts;
+	stringstream stream(spec);
+	string part;
+
+	while (getline(stream, part, ':'))
+		parts.push_back(part);
+
+	if (parts.size() < 2 || parts.size() > 3 || parts[0].empty() ||
+		(parts.size() == 3 && parts[2] != "0" && parts[2] != "1"))
+		return false;
+
+	column.Name = parts[0];
+	column.Indexed = (parts.size() == 3 && parts[2] == "1");
+
+	// split the distribution into its name and parameters
+	string dist = parts[1];
+	string params;
+	size_t equals = dist.find('=');
+
+	if (equals != string::npos)
+	{
+		params = dist.substr(equals + 1);
+		dist = dist.substr(0, equals);
+	}
+
+	if (dist == "unique" || dist == "sorted" || dist == "reverse")
+	{
+		column.Dist = (dist == "unique") ? DIST_UNIQUE : (dist == "sorted") ? DIST_SORTED : DIST_REVERSE;
+		column.Width = _digits(max(rows - 1, (int64_t) 0));
+	}
+	else if (dist == "uniform")
+	{
+		column.Dist = DIST_UNIFORM;
+		column.Domain = params.empty() ? rows : atoll(params.c_str());
+		column.Width = _digits(max(column.Domain - 1, (int64_t) 0));
+	}
+	else if (dist == "zipf")
+	{
+		column.Dist = DIST_ZIPF;
+		column.Exponent = 1.0;
+		column.Domain = min(rows, (int64_t) 100000);
+
+		if (!params.empty())
+		{
+			size_t slash = params.find('/');
+
+			column.Exponent = atof(params.substr(0, slash).c_str());
+			if (slash != string::npos)
+				column.Domain = atoll(params.substr(slash + 1).c_str());
+		}
+
+		column.Width = _digits(column.Domain);
+
+		// cumulative probabilities, rank k has weight 1/k^s
+		double total = 0;
+		column.Cdf.resize(max(column.Domain, (int64_t) 1));
+
+		for (int64_t k = 0; k < (int64_t) column.Cdf.size(); k++)
+		{
+			total += 1.0 / pow((double) (k + 1), column.Exponent);
+			column.Cdf[k] = total;
+		}
+
+		for (size_t k = 0; k < column.Cdf.size(); k++)
+			column.Cdf[k] /= total;
+	}
+	else if (dist == "text")
+	{
+		column.Dist = DIST_TEXT;
+		column.Domain = params.empty() ? 8 : atoll(params.c_str());
+		column.Width = (int) column.Domain;
+	}
+	else
+		return false;
+
+	return column.Domain > 0 || column.Dist == DIST_UNIQUE || column.Dist == DIST_SORTED ||
+		   column.Dist == DIST_REVERSE;
+}
+
+
+//
+// blockrandom
+//
+// Small, fast random generator (splitmix64), one per block of rows.
+//
+struct blockrandom
+{
+	uint64_t State;
+
+	blockrandom(uint64_t seed) : State(seed) {}
+
+	uint64_t operator()()
+	{
+		uint64_t z = (State += 0x9E3779B97F4A7C15ULL);
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		return z ^ (z >> 31);
+	}
+};
+
+
+//
+// _permute
+//
+// Maps i in [0, n) to a distinct value in [0, n): a keyed bijection on
+// the next power of two (xor-shifts and odd multiplies), walked until
+// it lands back inside [0, n).  Gives the unique distribution without
+// holding a shuffled array of every row.
+//
+static int64_t _permute(int64_t i, int64_t n, uint64_t seed)
+{
+	int bits = 1;
+	while (((uint64_t) 1 << bits) < (uint64_t) n)
+		bits++;
+
+	uint64_t mask = ((uint64_t) 1 << bits) - 1;
+	uint64_t x = (uint64_t) i;
+
+	do
+	{
+		x = (x ^ seed) & mask;
+		x ^= x >> (bits / 2 + 1);
+		x = (x * 0x9E3779B97F4A7C15ULL) & mask;
+		x ^= x >> (bits / 3 + 1);
+		x = (x * 0xBF58476D1CE4E5B9ULL) & mask;
+		x ^= x >> (bits / 2 + 1);
+	}
+	while (x >= (uint64_t) n);
+
+	return (int64_t) x;
+}
+
+
+//
+// _value
+//
+// Writes column's value for the given row at out, and returns the #
+// of characters written.
+//
+static int _value(const COLUMN& column, int64_t row, int64_t rows, uint64_t seed,
+				  blockrandom& random, char* out)
+{
+	int64_t n = 0;
+
+	switch (column.Dist)
+	{
+	case DIST_UNIQUE:
+		n = _permute(row, rows, seed);
+		break;
+	case DIST_SORTED:
+		n = row;
+		break;
+	case DIST_REVERSE:
+		n = rows - 1 - row;
+		break;
+	case DIST_UNIFORM:
+		n = random() % column.Domain;
+		break;
+	case DIST_ZIPF:
+	{
+		double u = (random() >> 11) * (1.0 / 9007199254740992.0);
+		n = upper_bound(column.Cdf.begin(), column.Cdf.end(), u) - column.Cdf.begin() + 1;
+		n = min(n, column.Domain);
+		break;
+	}
+	case DIST_TEXT:
+	{
+		// 13 letters from each random number
+		uint64_t bits = 0;
+
+		for (int64_t i = 0; i < column.Domain; i++)
+		{
+			if (i % 13 == 0)
+				bits = random();
+
+			out[i] = (char) ('a' + bits % 26);
+			bits /= 26;
+		}
+
+		return (int) column.Domain;
+	}
+	}
+
+	// digits backwards into a buffer, then copied out in order
+	char digits[24];
+	int length = 0;
+
+	do
+	{
+		digits[length++] = (char) ('0' + n % 10);
+		n /= 10;
+	}
+	while (n > 0);
+
+	for (int i = 0; i < length; i++)
+		out[i] = digits[length - 1 - i];
+
+	return length;
+}
+
+
+//
+// _writeblocks
+//
+// Worker thread: takes the next block of rows until none are left,
+// formats its records and writes them at the block's offset.  Returns
+// false (through ok) if a write fails.
+//
+static void _writeblocks(int fd, const vector<COLUMN>& columns, int64_t rows, int recordSize,
+						 uint64_t seed, atomic<int64_t>& nextBlock, atomic<bool>& ok)
+{
+	vector<char> block(BLOCKROWS * recordSize);
+
+	while (ok)
+	{
+		int64_t first = nextBlock.fetch_add(1) * BLOCKROWS;
+
+		if (first >= rows)
+			break;
+
+		int64_t last = min(first + BLOCKROWS, rows);
+
+		// each block has its own generator, so values don't depend on
+		// which thread writes the block
+		blockrandom random(seed * 1000003 + first);
+
+		for (int64_t row = first; row < last; row++)
+		{
+			char* record = &block[(row - first) * recordSize];
+			int length = 0;
+
+			for (size_t c = 0; c < columns.size(); c++)
+			{
+				if (c > 0)
+					record[length++] = ' ';
+
+				length += _value(columns[c], row, rows, seed + c, random, record + length);
+			}
+
+			// pad like the sample tables: a space, then '.' to the line ending
+			if (length + 2 < recordSize)
+				record[length++] = ' ';
+
+			memset(record + length, '.', recordSize - 2 - length);
+			record[recordSize - 2] = '\r';
+			record[recordSize - 1] = '\n';
+		}
+
+		size_t bytes = (last - first) * recordSize;
+
+		if (pwrite(fd, &block[0], bytes, first * recordSize) != (ssize_t) bytes)
+			ok = false;
+	}
+}
+
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2 || argv[1][0] == '-')
+	{
+		cout << "Usage: gen.exe TABLENAME [--rows N] [--record-size N] [--threads N] [--seed N] [--column name:distribution[:1]]..." << endl;
+		return 0;
+	}
+
+	string tablename = argv[1];
+	int64_t rows = 1000000;
+	int recordSize = 0;
+	int numthreads = max(1, (int) thread::hardware_concurrency());
+	uint64_t seed = 1;
+	vector<string> specs;
+
+	// check command line options
+	for (int i = 2; i < argc; i++)
+	{
+		string option = argv[i];
+
+		if (option == "--rows" && i + 1 < argc)
+			rows = atoll(argv[++i]);
+		else if (option == "--record-size" && i + 1 < argc)
+			recordSize = atoi(argv[++i]);
+		else if (option == "--threads" && i + 1 < argc)
+			numthreads = max(1, atoi(argv[++i]));
+		else if (option == "--seed" && i + 1 < argc)
+			seed = strtoull(argv[++i], nullptr, 10);
+		else if (option == "--column" && i + 1 < argc)
+			specs.push_back(argv[++i]);
+		else
+		{
+			cout << "**Error: unknown option '" << option << "'." << endl;
+			return 0;
+		}
+	}
+
+	// a stations-like table if no columns are given
+	if (specs.empty())
+	{
+		specs.push_back("id:unique:1");
+		specs.push_back("name:text=12:1");
+		specs.push_back("capacity:zipf=1.1/60");
+		specs.push_back("score:uniform=100000");
+		specs.push_back("opened:sorted");
+	}
+
+	vector<COLUMN> columns(specs.size());
+	int widest = 0;
+
+	for (size_t i = 0; i < specs.size(); i++)
+	{
+		if (!_parsecolumn(specs[i], rows, columns[i]))
+		{
+			cout << "**Error: invalid column '" << specs[i] << "'." << endl;
+			return 0;
+		}
+
+		widest += columns[i].Width + 1;
+	}
+
+	// values, a space between each and one before the padding, plus \r\n
+	if (recordSize == 0)
+		recordSize = widest + 2;
+
+	if (recordSize < widest + 1)
+	{
+		cout << "**Error: record size " << recordSize << " is too small, records need up to "
+			 << widest + 1 << " bytes." << endl;
+		return 0;
+	}
+
+	// the meta file, in the same layout and line endings as the samples;
+	// numeric columns are typed int so they index and compare as numbers
+	ofstream meta(tablename + ".meta", ios::out | ios::binary);
+
+	meta << recordSize << "\r\n" << columns.size() << "\r\n";
+	for (size_t i = 0; i < columns.size(); i++)
+	{
+		meta << columns[i].Name << " " << (columns[i].Indexed ? 1 : 0);
+		if (columns[i].Dist != DIST_TEXT)
+			meta << " int";
+		meta << "\r\n";
+	}
+
+	meta.close();
+
+	// the data file, sized up front so blocks can be written in any order
+	string datafilename = tablename + ".data";
+	int fd = open(datafilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+	if (fd < 0 || ftruncate(fd, rows * recordSize) != 0)
+	{
+		cout << "**Error: couldn't write data file '" << datafilename << "'." << endl;
+		return 0;
+	}
+
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	atomic<int64_t> nextblock(0);
+	atomic<bool> ok(true);
+	vector<thread> workers;
+
+	for (int i = 0; i < numthreads; i++)
+		workers.push_back(thread(_writeblocks, fd, cref(columns), rows, recordSize, seed, ref(nextblock), ref(ok)));
+
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+
+	close(fd);
+
+	if (!ok)
+	{
+		cout << "**Error: couldn't write data file '" << datafilename << "'." << endl;
+		return 0;
+	}
+
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+	double megabytes = rows * (double) recordSize / (1024 * 1024);
+
+	cout << "Wrote " << rows << " records of " << recordSize << " bytes to " << datafilename
+		 << " (" << megabytes << " MB in " << seconds << " s, "
+		 << (seconds > 0 ? megabytes / seconds : 0) << " MB/s)" << endl;
+
+	return 0;
+}
@@ -0,0 +1,319 @@
+/*hashtable.h*/
+
+// Open-addressing hash index for myDB project
+
+#pragma once
+
+#include <iostream>
+#include <cstdint>
+#include <cassert>
+#include <functional>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "stats.h"
+
+using namespace std;
+
+//
+// hashtable
+//
+// An unordered map from keys to values for indexes that are only ever
+// searched for equality, with the same search/insert/erase/build
+// interface as avltree.  It is one flat array of slots, probed linearly
+// with Robin Hood ordering:
+//
+//  - Hashes holds each slot's 32-bit key hash (0 if the slot is empty)
+//    apart from the keys, 16 to a cache line, and the key's home slot
+//    is the low bits of its hash.  A search compares the stored hashes
+//    (fingerprints) and only reads a key when its hash matches, so it
+//    usually costs one miss in Hashes and one in Entries.
+//  - Inserts keep every run of slots ordered by distance from home: a
+//    key displaces any key that is closer to its own home, so probe
+//    lengths stay short and even, and a search stops as soon as it
+//    passes a slot closer to home than it would be.
+//  - Erase shifts the keys after the slot back by one instead of
+//    leaving a tombstone.
+//
+// The table doubles when it is 7/8 full.
+//
+template<typename TKey, typename TValue>
+class hashtable
+{
+private:
+	struct ENTRY
+	{
+		TKey Key;
+		TValue Value;
+	};
+	
+	vector<uint32_t> Hashes; // hash of each slot's key, 0 if empty
+	vector<ENTRY> Entries;   // key and value of each slot
+	size_t Size;
+	size_t Mask;             // # of slots - 1, a power of 2 - 1
+	
+	// _hash function (32-bit hash of a key, never 0); the standard hash
+	// is the number itself for integers, so it's mixed to spread keys
+	// that differ only in their high bits
+	static uint32_t _hash(const TKey& key)
+	{
+		uint64_t h = std::hash<TKey>()(key);
+		
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		h *= 0xc4ceb9fe1a85ec53ULL;
+		h ^= h >> 33;
+		
+		uint32_t folded = (uint32_t) (h ^ (h >> 32));
+		
+		return (folded == 0) ? 1 : folded;
+	}
+	
+	// _distance function (# of slots the key in slot i is past its home)
+	size_t _distance(size_t i) const
+	{
+		return (i - (Hashes[i] & Mask)) & Mask;
+	}
+	
+	// _find function (slot holding key, or -1 if not in the table)
+	ptrdiff_t _find(const TKey& key) const
+	{
+		if (Size == 0)
+			return -1;
+		
+		uint32_t hash = _hash(key);
+		size_t i = hash & Mask;
+		uint64_t visited = 0;
+		ptrdiff_t found = -1;
+		
+		// walk the run until the key, an empty slot, or a key closer
+		// to its home than this one would be
+		for (size_t distance = 0; Hashes[i] != 0 && _distance(i) >= distance; distance++)
+		{
+			visited++;
+			
+			if (Hashes[i] == hash && Entries[i].Key == key)
+			{
+				found = i;
+				break;
+			}
+			
+			i = (i + 1) & Mask;
+		}
+		
+		StatCount(COUNT_SEARCHES, 1);
+		StatCount(COUNT_NODESVISITED, visited);
+		
+		return found;
+	}
+	
+	// _place function (put a key not in the table into its slot, moving
+	// closer-to-home keys along)
+	void _place(uint32_t hash, ENTRY&& entry)
+	{
+		size_t i = hash & Mask;
+		
+		for (size_t distance = 0; ; distance++)
+		{
+			if (Hashes[i] == 0)
+			{
+				Hashes[i] = hash;
+				Entries[i] = std::move(entry);
+				Size++;
+				return;
+			}
+			
+			// the key here is closer to home than the one being placed,
+			// so it takes this slot and that key moves on instead
+			if (_distance(i) < distance)
+			{
+				distance = _distance(i);
+				swap(Hashes[i], hash);
+				swap(Entries[i], entry);
+			}
+			
+			i = (i + 1) & Mask;
+		}
+	}
+	
+	// _resize function (rehash every key into a table of given # of
+	// slots, a power of 2)
+	void _resize(size_t slots)
+	{
+		vector<uint32_t> hashes(slots, 0);
+		vector<ENTRY> entries(slots);
+		
+		hashes.swap(Hashes);
+		entries.swap(Entries);
+		Mask = slots - 1;
+		Size = 0;
+		
+		for (size_t i = 0; i < hashes.size(); i++)
+		{
+			if (hashes[i] != 0)
+				_place(hashes[i], std::move(entries[i]));
+		}
+	}
+	
+	// _reserve function (grow so n keys fit under the 7/8 load limit)
+	void _reserve(size_t n)
+	{
+		size_t slots = max((size_t) 16, Hashes.size());
+		
+		while (n > slots / 8 * 7)
+			slots *= 2;
+		
+		if (slots != Hashes.size())
+			_resize(slots);
+	}
+	
+	// _inorder function (occupied slots in key order, for saving)
+	vector<size_t> _inorder() const
+	{
+		vector<size_t> slots;
+		slots.reserve(Size);
+		
+		for (size_t i = 0; i < Hashes.size(); i++)
+		{
+			if (Hashes[i] != 0)
+				slots.push_back(i);
+		}
+		
+		sort(slots.begin(), slots.end(), [this](size_t a, size_t b)
+		{
+			return Entries[a].Key < Entries[b].Key;
+		});
+		
+		return slots;
+	}
+
+public:
+	// default constructor
+	hashtable()
+		: Size(0), Mask(0)
+	{
+	}
+	
+	// size function (num of keys in table)
+	int size() const
+	{
+		return (int) Size;
+	}
+	
+	// slots function (num of slots, used or not)
+	size_t slots() const
+	{
+		return Hashes.size();
+	}
+	
+	// longestprobe function (most slots any key is past its home)
+	int longestprobe() const
+	{
+		size_t longest = 0;
+		
+		for (size_t i = 0; i < Hashes.size(); i++)
+		{
+			if (Hashes[i] != 0)
+				longest = max(longest, _distance(i));
+		}
+		
+		return (int) longest;
+	}
+	
+	// clear function
+	void clear()
+	{
+		Hashes.clear();
+		Entries.clear();
+		Size = 0;
+		Mask = 0;
+	}
+	
+	// search function (search table for given key)
+	TValue* search(const TKey& key)
+	{
+		ptrdiff_t i = _find(key);
+		
+		return (i >= 0) ? &Entries[i].Value : nullptr;
+	}
+	
+	// insert function (add key with value, unless key is in table already)
+	void insert(TKey key, TValue value)
+	{
+		if (_find(key) >= 0)
+			return;
+		
+		// hash before the key is moved into its entry
+		uint32_t hash = _hash(key);
+		
+		_reserve(Size + 1);
+		_place(hash, ENTRY{std::move(key), std::move(value)});
+	}
+	
+	// build function (replace table with the given keys/values), keys
+	// must be distinct, values match keys by position; sized up front so
+	// it never rehashes
+	void build(const std::vector<TKey>& keys, const std::vector<TValue>& values)
+	{
+		assert(keys.size() == values.size());
+		
+		clear();
+		_reserve(keys.size());
+		
+		for (size_t i = 0; i < keys.size(); i++)
+			_place(_hash(keys[i]), ENTRY{keys[i], values[i]});
+	}
+	
+	// erase function (remove given key, shifting the keys after it back)
+	// returns false if the key is not in the table
+	bool erase(const TKey& key)
+	{
+		ptrdiff_t found = _find(key);
+		
+		if (found < 0)
+			return false;
+		
+		size_t i = found;
+		size_t next = (i + 1) & Mask;
+		
+		while (Hashes[next] != 0 && _distance(next) > 0)
+		{
+			Hashes[i] = Hashes[next];
+			Entries[i] = std::move(Entries[next]);
+			
+			i = next;
+			next = (next + 1) & Mask;
+		}
+		
+		Hashes[i] = 0;
+		Entries[i] = ENTRY();
+		Size--;
+		
+		return true;
+	}
+	
+	// inorder_keys function (every key, sorted)
+	vector<TKey> inorder_keys() const
+	{
+		vector<TKey> keys;
+		
+		for (size_t i : _inorder())
+			keys.push_back(Entries[i].Key);
+		
+		return keys;
+	}
+	
+	// inorder_values function (every value, in sorted key order)
+	vector<TValue> inorder_values() const
+	{
+		vector<TValue> values;
+		
+		for (size_t i : _inorder())
+			values.push_back(Entries[i].Value);
+		
+		return values;
+	}
+};
@@ -0,0 +1,685 @@
+/*index.cpp*/
+
+// Typed column indexes for myDB project
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <utility>
+
+#include "index.h"
+#include "indexfile.h"
+#include "stats.h"
+#include "util.h"
+
+using namespace std;
+
+
+//
+// _keytype
+//
+// The key type of an index tree, frozen tree or hash table, so the
+// helpers below can parse values and predicates into it.
+//
+template<typename TIndex>
+struct _keytype;
+
+template<typename TKey, typename TValue, template<typename> class TAllocator>
+struct _keytype<avltree<TKey, TValue, TAllocator>>
+{
+	typedef TKey type;
+};
+
+template<typename TKey, typename TValue>
+struct _keytype<frozentree<TKey, TValue>>
+{
+	typedef TKey type;
+};
+
+template<typename TKey, typename TValue>
+struct _keytype<hashtable<TKey, TValue>>
+{
+	typedef TKey type;
+};
+
+template<typename TValue>
+struct _keytype<compactavltree<TValue>>
+{
+	typedef string type;
+};
+
+
+//
+// _walk
+//
+// Calls visit with the posting list of every key of an index tree (or
+// its frozen snapshot) that matches the predicate.  Equality is a point
+// search; every other comparison matches one run of consecutive keys,
+// so the tree is walked from the first matching key and stops at the
+// first key past the run.  Keys are visited in order.
+//
+template<typename TTree, typename TVisit>
+static void _walk(TTree& tree, const predicate& pred, TVisit visit)
+{
+	typedef typename _keytype<TTree>::type TKey;
+	const TKey& key = pred.key<TKey>();
+	
+	if (pred.Op == OP_EQUAL)
+	{
+		postinglist* postings = tree.search(key);
+		
+		if (postings != nullptr)
+			visit(*postings);
+		
+		return;
+	}
+	
+	// position the walk at the start of the run of matching keys
+	typename TTree::iterator it;
+	
+	if (pred.Op == OP_LESS || pred.Op == OP_LESSEQUAL)
+		it = tree.begin();
+	else if (pred.Op == OP_GREATER)
+		it = tree.upper_bound(key);
+	else
+		it = tree.lower_bound(key);
+	
+	for ( ; !it.done() && pred.matches(it.key()); it.next())
+		visit(it.value());
+}
+
+
+//
+// _walk (hash tables)
+//
+// Same, for a hash index: only equality finds anything, callers check
+// answers() before searching.
+//
+template<typename TKey, typename TVisit>
+static void _walk(hashtable<TKey, postinglist>& table, const predicate& pred, TVisit visit)
+{
+	if (pred.Op != OP_EQUAL)
+		return;
+	
+	postinglist* postings = table.search(pred.key<TKey>());
+	
+	if (postings != nullptr)
+		visit(*postings);
+}
+
+
+//
+// _search
+//
+// Returns the positions of every record matching the predicate, in key
+// order; see _walk.
+//
+template<typename TIndex>
+static vector<streamoff> _search(TIndex& index, const predicate& pred)
+{
+	scopedtimer timer(TIME_INDEXSEARCH);
+	vector<streamoff> posvect;
+	
+	_walk(index, pred, [&posvect](const postinglist& postings)
+	{
+		for (size_t i = 0; i < postings.size(); i++)
+			posvect.push_back(postings[i]);
+	});
+	
+	return posvect;
+}
+
+
+//
+// _count
+//
+// Returns the # of records matching the predicate from the sizes of
+// their posting lists, without reading a record; see _walk.
+//
+template<typename TIndex>
+static int64_t _count(TIndex& index, const predicate& pred)
+{
+	scopedtimer timer(TIME_INDEXSEARCH);
+	int64_t count = 0;
+	
+	_walk(index, pred, [&count](const postinglist& postings)
+	{
+		count += postings.size();
+	});
+	
+	return count;
+}
+
+
+//
+// _build
+//
+// Parses a column's (value, position) pairs as the column's type and
+// builds the tree (or hash table) from them; values that don't parse
+// are left out.
+//
+template<typename TIndex>
+static void _build(TIndex& index, columntype type, vector<pair<string, streamoff>>& columnPairs)
+{
+	typedef typename _keytype<TIndex>::type TKey;
+	vector<pair<TKey, streamoff>> keypairs;
+	keypairs.reserve(columnPairs.size());
+	
+	for (size_t i = 0; i < columnPairs.size(); i++)
+	{
+		const string& value = columnPairs[i].first;
+		TKey key;
+		
+		if (ParseValue(value.data(), value.size(), type, key))
+			keypairs.push_back(make_pair(key, columnPairs[i].second));
+	}
+	
+	columnPairs.clear();
+	
+	vector<TKey> keys;
+	vector<postinglist> values;
+	
+	GroupIndexColumn(keypairs, keys, values);
+	index.build(keys, values);
+}
+
+
+//
+// _load
+//
+// Builds the tree (or hash table) from the column's index file; false
+// if it is stale.
+//
+template<typename TIndex>
+static bool _load(TIndex& index, columntype type, string tablename, string columnname, int column)
+{
+	vector<typename _keytype<TIndex>::type> keys;
+	vector<postinglist> values;
+	
+	if (!LoadIndexFile(tablename, columnname, column, type, keys, values))
+		return false;
+	
+	index.build(keys, values);
+	return true;
+}
+
+
+//
+// _add
+//
+// Adds pos to the posting list of a value's key, if it parses.
+//
+template<typename TIndex>
+static bool _add(TIndex& index, columntype type, const string& value, streamoff pos)
+{
+	typename _keytype<TIndex>::type key;
+	
+	if (!ParseValue(value.data(), value.size(), type, key))
+		return false;
+	
+	postinglist* postings = index.search(key);
+	
+	if (postings != nullptr)
+		postings->add(pos);
+	else
+		index.insert(key, postinglist(pos));
+	
+	return true;
+}
+
+
+//
+// _remove
+//
+// Removes pos from the posting list of a value's key, dropping the key
+// once it has no records left.
+//
+template<typename TIndex>
+static void _remove(TIndex& index, columntype type, const string& value, streamoff pos)
+{
+	typename _keytype<TIndex>::type key;
+	
+	if (!ParseValue(value.data(), value.size(), type, key))
+		return;
+	
+	postinglist* postings = index.search(key);
+	
+	if (postings != nullptr)
+	{
+		postings->remove(pos);
+		
+		if (postings->size() == 0)
+			index.erase(key);
+	}
+}
+
+
+//
+// _height
+//
+// The height of a tree, or the longest probe of any key in a hash table.
+//
+template<typename TIndex>
+static int _height(TIndex& index)
+{
+	return index.height();
+}
+
+template<typename TKey>
+static int _height(hashtable<TKey, postinglist>& table)
+{
+	return table.longestprobe();
+}
+
+
+//
+// _first / _last
+//
+// The posting list of the smallest / largest key of a tree, null if it
+// is empty.  A hash table has no order, so always null.
+//
+template<typename TIndex>
+static const postinglist* _first(TIndex& index)
+{
+	return index.first();
+}
+
+template<typename TKey>
+static const postinglist* _first(hashtable<TKey, postinglist>&)
+{
+	return nullptr;
+}
+
+template<typename TIndex>
+static const postinglist* _last(TIndex& index)
+{
+	return index.last();
+}
+
+template<typename TKey>
+static const postinglist* _last(hashtable<TKey, postinglist>&)
+{
+	return nullptr;
+}
+
+
+//
+// _freeze
+//
+// A read-only snapshot of a tree laid out for fast searching, see
+// frozentree.  A hash table is already flat, and is just copied.
+//
+template<typename TIndex>
+static auto _freeze(TIndex& index) -> decltype(index.freeze())
+{
+	return index.freeze();
+}
+
+template<typename TKey>
+static hashtable<TKey, postinglist> _freeze(hashtable<TKey, postinglist>& table)
+{
+	return table;
+}
+
+
+//
+// Visitors
+//
+// Function objects that _dispatch calls with the active tree or hash
+// table, one per columnindex / frozenindex method; each just forwards to
+// the typed helper above with the method's arguments.
+//
+struct _searchvisit
+{
+	const predicate& Pred;
+	
+	template<typename TIndex>
+	vector<streamoff> operator()(TIndex& index) const { return _search(index, Pred); }
+};
+
+struct _countvisit
+{
+	const predicate& Pred;
+	
+	template<typename TIndex>
+	int64_t operator()(TIndex& index) const { return _count(index, Pred); }
+};
+
+struct _firstvisit
+{
+	template<typename TIndex>
+	const postinglist* operator()(TIndex& index) const { return _first(index); }
+};
+
+struct _lastvisit
+{
+	template<typename TIndex>
+	const postinglist* operator()(TIndex& index) const { return _last(index); }
+};
+
+struct _sizevisit
+{
+	template<typename TIndex>
+	int operator()(TIndex& index) const { return index.size(); }
+};
+
+struct _heightvisit
+{
+	template<typename TIndex>
+	int operator()(TIndex& index) const { return _height(index); }
+};
+
+struct _loadvisit
+{
+	columntype Type;
+	const string& TableName;
+	const string& ColumnName;
+	int Column;
+	
+	template<typename TIndex>
+	bool operator()(TIndex& index) const { return _load(index, Type, TableName, ColumnName, Column); }
+};
+
+struct _buildvisit
+{
+	columntype Type;
+	vector<pair<string, streamoff>>& ColumnPairs;
+	
+	template<typename TIndex>
+	void operator()(TIndex& index) const { _build(index, Type, ColumnPairs); }
+};
+
+struct _savevisit
+{
+	columntype Type;
+	const string& TableName;
+	const string& ColumnName;
+	int Column;
+	
+	template<typename TIndex>
+	bool operator()(TIndex& index) const
+	{
+		return SaveIndexFile(TableName, ColumnName, Column, Type, index.inorder_keys(), index.inorder_values());
+	}
+};
+
+struct _addvisit
+{
+	columntype Type;
+	const string& Value;
+	streamoff Pos;
+	
+	template<typename TIndex>
+	bool operator()(TIndex& index) const { return _add(index, Type, Value, Pos); }
+};
+
+struct _removevisit
+{
+	columntype Type;
+	const string& Value;
+	streamoff Pos;
+	
+	template<typename TIndex>
+	void operator()(TIndex& index) const { _remove(index, Type, Value, Pos); }
+};
+
+struct _freezevisit
+{
+	frozenindex& Frozen;
+	
+	template<typename TIndex>
+	void operator()(TIndex& index) const { Frozen._hold(_freeze(index)); }
+};
+
+
+//
+// frozenindex::_dispatch
+//
+// Calls visit with the snapshot's active frozen tree or hash table, the
+// one of its kind and type, and returns what visit returns.  A compact
+// index is string-keyed, so its snapshot is in Strings.
+//
+template<typename TVisit>
+auto frozenindex::_dispatch(TVisit visit) -> decltype(visit(Strings))
+{
+	if (Kind == INDEX_HASH)
+	{
+		switch (Type)
+		{
+			case TYPE_INT:
+			case TYPE_DATE:
+				return visit(IntegerHash);
+			case TYPE_DOUBLE:
+				return visit(RealHash);
+			default:
+				return visit(StringHash);
+		}
+	}
+	
+	switch (Type)
+	{
+		case TYPE_INT:
+		case TYPE_DATE:
+			return visit(Integers);
+		case TYPE_DOUBLE:
+			return visit(Reals);
+		default:
+			return visit(Strings);
+	}
+}
+
+
+//
+// frozenindex::search
+//
+// Searches the snapshot for the records matching the predicate, which
+// must have been set to the column's type; see _search.
+//
+vector<streamoff> frozenindex::search(const predicate& pred)
+{
+	return _dispatch(_searchvisit{pred});
+}
+
+
+//
+// frozenindex::count
+//
+// Returns the # of records matching the predicate without reading
+// them, see _count.
+//
+int64_t frozenindex::count(const predicate& pred)
+{
+	return _dispatch(_countvisit{pred});
+}
+
+
+//
+// frozenindex::first / last
+//
+// The posting list of the smallest / largest key, null if empty (or a
+// hash index).
+//
+const postinglist* frozenindex::first()
+{
+	return _dispatch(_firstvisit());
+}
+
+const postinglist* frozenindex::last()
+{
+	return _dispatch(_lastvisit());
+}
+
+
+//
+// columnindex::_dispatch
+//
+// Calls visit with the index's active tree or hash table, the one of
+// its kind and type, and returns what visit returns.  Every method goes
+// through here, so a new kind or type is only added in one place.
+//
+template<typename TVisit>
+auto columnindex::_dispatch(TVisit visit) -> decltype(visit(Strings))
+{
+	if (Kind == INDEX_COMPACT)
+		return visit(Compact);
+	
+	if (Kind == INDEX_HASH)
+	{
+		switch (Type)
+		{
+			case TYPE_INT:
+			case TYPE_DATE:
+				return visit(IntegerHash);
+			case TYPE_DOUBLE:
+				return visit(RealHash);
+			default:
+				return visit(StringHash);
+		}
+	}
+	
+	switch (Type)
+	{
+		case TYPE_INT:
+		case TYPE_DATE:
+			return visit(Integers);
+		case TYPE_DOUBLE:
+			return visit(Reals);
+		default:
+			return visit(Strings);
+	}
+}
+
+
+//
+// columnindex::size / height
+//
+// # of distinct keys in the index, and the height of its tree (for a
+// hash index, the longest probe of any key).
+//
+int columnindex::size()
+{
+	return _dispatch(_sizevisit());
+}
+
+int columnindex::height()
+{
+	return _dispatch(_heightvisit());
+}
+
+
+//
+// columnindex::load
+//
+// Builds the index from the column's index file.  Returns false if the
+// file is missing or stale, see LoadIndexFile.
+//
+bool columnindex::load(string tablename, string columnname, int column)
+{
+	return _dispatch(_loadvisit{Type, tablename, columnname, column});
+}
+
+
+//
+// columnindex::build
+//
+// Builds the index from one column's (value, position) pairs, from
+// ReadIndexColumns.  columnPairs is emptied.
+//
+void columnindex::build(vector<pair<string, streamoff>>& columnPairs)
+{
+	_dispatch(_buildvisit{Type, columnPairs});
+}
+
+
+//
+// columnindex::save
+//
+// Writes the index to the column's index file, in key order whatever
+// its kind.  Returns false if the file couldn't be written.
+//
+bool columnindex::save(string tablename, string columnname, int column)
+{
+	return _dispatch(_savevisit{Type, tablename, columnname, column});
+}
+
+
+//
+// columnindex::add
+//
+// Adds the record at pos under its column value.  Returns false (and
+// leaves the index alone) if the value isn't valid for the type.
+//
+bool columnindex::add(const string& value, streamoff pos)
+{
+	return _dispatch(_addvisit{Type, value, pos});
+}
+
+
+//
+// columnindex::remove
+//
+// Removes the record at pos from under its column value.
+//
+void columnindex::remove(const string& value, streamoff pos)
+{
+	_dispatch(_removevisit{Type, value, pos});
+}
+
+
+//
+// columnindex::search
+//
+// Searches the index itself for the records matching the predicate,
+// which must have been set to the column's type; see _search.
+//
+vector<streamoff> columnindex::search(const predicate& pred)
+{
+	return _dispatch(_searchvisit{pred});
+}
+
+
+//
+// columnindex::count
+//
+// Returns the # of records matching the predicate without reading
+// them, see _count.
+//
+int64_t columnindex::count(const predicate& pred)
+{
+	return _dispatch(_countvisit{pred});
+}
+
+
+//
+// columnindex::first / last
+//
+// The posting list of the smallest / largest key, from the leftmost /
+// rightmost node of the tree in O(log n); null if empty, or if it is a
+// hash index.
+//
+const postinglist* columnindex::first()
+{
+	return _dispatch(_firstvisit());
+}
+
+const postinglist* columnindex::last()
+{
+	return _dispatch(_lastvisit());
+}
+
+
+//
+// columnindex::freeze
+//
+// Returns a read-only snapshot of the index laid out for fast searching,
+// see _freeze.
+//
+frozenindex columnindex::freeze()
+{
+	frozenindex frozen(Type, Kind);
+	
+	_dispatch(_freezevisit{frozen});
+	
+	return frozen;
+}
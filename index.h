@@ -0,0 +1,179 @@
+/*index.h*/
+
+// Typed column indexes for myDB project
+
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <utility>
+
+#include "avl.h"
+#include "compactavl.h"
+#include "frozen.h"
+#include "hashtable.h"
+#include "postings.h"
+#include "scan.h"
+#include "types.h"
+
+using namespace std;
+
+//
+// indexkind
+//
+// How an indexed column is indexed, from the second word of its line in
+// the .meta file: 1 for an ordered tree, which answers every predicate,
+// hash for a hash table, which only answers equality but answers it
+// in O(1), or compact for an ordered tree of a string column with
+// smaller, array-stored nodes (see compactavl.h).
+//
+enum indexkind
+{
+	INDEX_TREE,   // avltree, "1"
+	INDEX_HASH,   // hashtable, "hash"
+	INDEX_COMPACT // compactavltree, "compact", string columns only
+};
+
+//
+// frozenindex
+//
+// Read-only snapshot of a columnindex, made by columnindex::freeze().
+// Only the frozen tree (or copy of the hash table) of the column's type
+// holds keys; a compact index freezes to the same frozen string tree as
+// a plain one.
+//
+class frozenindex
+{
+private:
+	columntype Type;
+	indexkind Kind;
+	frozentree<string, postinglist> Strings;
+	frozentree<int64_t, postinglist> Integers;
+	frozentree<double, postinglist> Reals;
+	hashtable<string, postinglist> StringHash;
+	hashtable<int64_t, postinglist> IntegerHash;
+	hashtable<double, postinglist> RealHash;
+	
+	template<typename TVisit>
+	auto _dispatch(TVisit visit) -> decltype(visit(Strings));
+	
+	// _hold functions (take the frozen tree or hash table columnindex::freeze
+	// made of its active one)
+	void _hold(frozentree<string, postinglist>&& index) { Strings = std::move(index); }
+	void _hold(frozentree<int64_t, postinglist>&& index) { Integers = std::move(index); }
+	void _hold(frozentree<double, postinglist>&& index) { Reals = std::move(index); }
+	void _hold(hashtable<string, postinglist>&& index) { StringHash = std::move(index); }
+	void _hold(hashtable<int64_t, postinglist>&& index) { IntegerHash = std::move(index); }
+	void _hold(hashtable<double, postinglist>&& index) { RealHash = std::move(index); }
+	
+	friend class columnindex;
+	friend struct _freezevisit; // columnindex::freeze's visitor, index.cpp
+
+public:
+	frozenindex(columntype type = TYPE_STRING, indexkind kind = INDEX_TREE)
+		: Type(type), Kind(kind)
+	{
+	}
+	
+	indexkind kind() const
+	{
+		return Kind;
+	}
+	
+	bool answers(const predicate& pred) const
+	{
+		return Kind != INDEX_HASH || pred.Op == OP_EQUAL;
+	}
+	
+	vector<streamoff> search(const predicate& pred);
+	
+	int64_t count(const predicate& pred);
+	
+	const postinglist* first();
+	
+	const postinglist* last();
+};
+
+//
+// columnindex
+//
+// The index tree of one column, keyed by the column's values parsed as
+// its type: an avltree<string, ...> for strings, avltree<int64_t, ...>
+// for ints and dates, avltree<double, ...> for doubles.  Only the tree
+// of the column's type holds keys; values are parsed once, when they
+// go into the tree, so searches compare native keys in the type's own
+// order ("45" < "109" for an int column).  Values that aren't valid for
+// the type are left out of the index, they never match a predicate on
+// the column anyway.
+//
+// A hash index keeps the keys in a hashtable of the same key type
+// instead.  It only answers equality (see answers()), and has no first
+// or last key; callers search some other way for the rest.  A compact
+// index keeps a string column's keys in a compactavltree, which answers
+// everything a tree does in less memory.
+//
+class columnindex
+{
+private:
+	columntype Type;
+	indexkind Kind;
+	avltree<string, postinglist> Strings;   // TYPE_STRING
+	avltree<int64_t, postinglist> Integers; // TYPE_INT and TYPE_DATE
+	avltree<double, postinglist> Reals;     // TYPE_DOUBLE
+	hashtable<string, postinglist> StringHash;   // same, for INDEX_HASH
+	hashtable<int64_t, postinglist> IntegerHash;
+	hashtable<double, postinglist> RealHash;
+	compactavltree<postinglist> Compact;    // TYPE_STRING, for INDEX_COMPACT
+	
+	template<typename TVisit>
+	auto _dispatch(TVisit visit) -> decltype(visit(Strings));
+
+public:
+	columnindex(columntype type = TYPE_STRING, indexkind kind = INDEX_TREE)
+		: Type(type), Kind(kind)
+	{
+	}
+	
+	columntype type() const
+	{
+		return Type;
+	}
+	
+	indexkind kind() const
+	{
+		return Kind;
+	}
+	
+	// true if the index can search for the predicate (a hash index only
+	// finds equal keys)
+	bool answers(const predicate& pred) const
+	{
+		return Kind != INDEX_HASH || pred.Op == OP_EQUAL;
+	}
+	
+	int size();
+	
+	int height();
+	
+	bool load(string tablename, string columnname, int column);
+	
+	void build(vector<pair<string, streamoff>>& columnPairs);
+	
+	bool save(string tablename, string columnname, int column);
+	
+	bool add(const string& value, streamoff pos);
+	
+	void remove(const string& value, streamoff pos);
+	
+	vector<streamoff> search(const predicate& pred);
+	
+	int64_t count(const predicate& pred);
+	
+	const postinglist* first();
+	
+	const postinglist* last();
+	
+	frozenindex freeze();
+};
@@ -0,0 +1,352 @@
+/*indexfile.cpp*/
+
+// Persistent index sidecar files for myDB project
+//
+// An index file "<table>.<column>.idx" holds one index tree's sorted keys
+// and posting lists, so startup can bulk-build the tree without reading
+// the .data file.  Layout (native byte order):
+//
+//   header      INDEXHEADER below
+//   per key     uint32 key length, key bytes,
+//               uint32 # of positions, int64 positions...
+//
+// Keys of a string column are its values; keys of a typed column are
+// their parsed int64_t or double, 8 native bytes each (see types.h).
+// The header records the column's type and the .data file's size and
+// modification time; if any has changed since the index was written,
+// the file is stale.
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "indexfile.h"
+#include "stats.h"
+
+using namespace std;
+
+static const char INDEXMAGIC[8] = {'m', 'y', 'D', 'B', 'i', 'd', 'x', '1'};
+
+struct INDEXHEADER
+{
+	char Magic[8];
+	int64_t DataSize;      // size of the .data file when written
+	int64_t DataMtimeSec;  // modification time of the .data file when written
+	int64_t DataMtimeNsec;
+	int64_t NumKeys;
+	int32_t Column;        // 0-based column the index is on
+	int32_t Type;          // columntype of the keys, 0 (string) in older files
+};
+
+
+//
+// _datastamp
+//
+// Fills the header's size and modification time from the table's
+// .data file.  Returns false if the file can't be stat'ed.
+//
+static bool _datastamp(string tablename, INDEXHEADER& header)
+{
+	struct stat info;
+	string filename = tablename + ".data";
+	
+	if (stat(filename.c_str(), &info) != 0)
+		return false;
+	
+	header.DataSize = info.st_size;
+	header.DataMtimeSec = info.st_mtim.tv_sec;
+	header.DataMtimeNsec = info.st_mtim.tv_nsec;
+	
+	return true;
+}
+
+
+//
+// IndexFileName
+//
+// Returns the index file name for a table's column.
+//
+// Example: IndexFileName("students", "netid") returns "students.netid.idx".
+//
+string IndexFileName(string tablename, string columnname)
+{
+	return tablename + "." + columnname + ".idx";
+}
+
+
+//
+// _readkey
+//
+// Sets key from its length bytes in an index file.  Returns false if
+// they aren't a key of this type.
+//
+static bool _readkey(const char* data, uint32_t length, string& key)
+{
+	key.assign(data, length);
+	return true;
+}
+
+template<typename TKey>
+static bool _readkey(const char* data, uint32_t length, TKey& key)
+{
+	if (length != sizeof(TKey))
+		return false;
+	
+	memcpy(&key, data, sizeof(TKey));
+	return true;
+}
+
+
+//
+// _writekey
+//
+// Writes a key's length and bytes to an index file.
+//
+static void _writekey(ostream& out, const string& key)
+{
+	uint32_t keylength = key.size();
+	
+	out.write((const char*) &keylength, sizeof(uint32_t));
+	out.write(key.data(), keylength);
+}
+
+template<typename TKey>
+static void _writekey(ostream& out, const TKey& key)
+{
+	uint32_t keylength = sizeof(TKey);
+	
+	out.write((const char*) &keylength, sizeof(uint32_t));
+	out.write((const char*) &key, sizeof(TKey));
+}
+
+
+//
+// LoadIndexFile
+//
+// Maps a column's index file and reads its sorted keys and posting lists
+// into keys/values, ready for avltree::build.  Returns false (and leaves
+// keys/values empty) if there is no index file, it is for a different
+// column or type, or the .data file changed after it was written.
+//
+template<typename TKey>
+static bool _loadindexfile(string tablename, string columnname, int column, columntype type,
+						   vector<TKey>& keys, vector<postinglist>& values)
+{
+	keys.clear();
+	values.clear();
+	
+	INDEXHEADER current;
+	if (!_datastamp(tablename, current))
+		return false;
+	
+	string filename = IndexFileName(tablename, columnname);
+	int fd = open(filename.c_str(), O_RDONLY);
+	StatCount(COUNT_FILEOPENS, 1);
+	
+	if (fd < 0)
+		return false;
+	
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size < (off_t) sizeof(INDEXHEADER))
+	{
+		close(fd);
+		return false;
+	}
+	
+	void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	StatCount(COUNT_BYTESREAD, info.st_size);
+	
+	if (mapping == MAP_FAILED)
+		return false;
+	
+	const char* cur = (const char*) mapping;
+	const char* end = cur + info.st_size;
+	bool ok = true;
+	
+	INDEXHEADER header;
+	memcpy(&header, cur, sizeof(header));
+	cur += sizeof(header);
+	
+	// check the file is an index of this column for the current .data file
+	if (memcmp(header.Magic, INDEXMAGIC, sizeof(INDEXMAGIC)) != 0 ||
+		header.Column != column ||
+		header.Type != (int32_t) type ||
+		header.DataSize != current.DataSize ||
+		header.DataMtimeSec != current.DataMtimeSec ||
+		header.DataMtimeNsec != current.DataMtimeNsec)
+		ok = false;
+	
+	// every key takes at least its length and its # of positions, so a
+	// count the rest of the file can't hold means it is truncated or
+	// corrupt; rebuild rather than reserve room for it
+	if (header.NumKeys < 0 || header.NumKeys > (end - cur) / (ptrdiff_t) (2 * sizeof(uint32_t)))
+		ok = false;
+	
+	if (ok)
+	{
+		keys.reserve(header.NumKeys);
+		values.reserve(header.NumKeys);
+	}
+	
+	// read each key and its posting list, checking we stay inside the file
+	for (int64_t i = 0; ok && i < header.NumKeys; i++)
+	{
+		uint32_t keylength, numpositions;
+		
+		if (end - cur < (ptrdiff_t) sizeof(uint32_t))
+		{
+			ok = false;
+			break;
+		}
+		memcpy(&keylength, cur, sizeof(uint32_t));
+		cur += sizeof(uint32_t);
+		
+		if ((uint64_t) (end - cur) < (uint64_t) keylength + sizeof(uint32_t))
+		{
+			ok = false;
+			break;
+		}
+		keys.push_back(TKey());
+		if (!_readkey(cur, keylength, keys.back()))
+		{
+			ok = false;
+			break;
+		}
+		cur += keylength;
+		
+		memcpy(&numpositions, cur, sizeof(uint32_t));
+		cur += sizeof(uint32_t);
+		
+		if ((uint64_t) (end - cur) < (uint64_t) numpositions * sizeof(int64_t))
+		{
+			ok = false;
+			break;
+		}
+		
+		values.push_back(postinglist());
+		for (uint32_t j = 0; j < numpositions; j++)
+		{
+			int64_t pos;
+			memcpy(&pos, cur, sizeof(int64_t));
+			cur += sizeof(int64_t);
+			
+			values.back().add(pos);
+		}
+	}
+	
+	munmap(mapping, info.st_size);
+	
+	if (!ok)
+	{
+		keys.clear();
+		values.clear();
+	}
+	
+	return ok;
+}
+
+
+//
+// SaveIndexFile
+//
+// Writes a column's sorted keys and posting lists to its index file,
+// stamped with the current size and modification time of the .data
+// file.  The file is written under a temporary name and renamed into
+// place, so a reader never sees half an index.  Returns false if the
+// file couldn't be written.
+//
+template<typename TKey>
+static bool _saveindexfile(string tablename, string columnname, int column, columntype type,
+						   const vector<TKey>& keys, const vector<postinglist>& values)
+{
+	INDEXHEADER header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.Magic, INDEXMAGIC, sizeof(INDEXMAGIC));
+	header.NumKeys = keys.size();
+	header.Column = column;
+	header.Type = type;
+	
+	if (!_datastamp(tablename, header))
+		return false;
+	
+	string filename = IndexFileName(tablename, columnname);
+	string tempname = filename + ".tmp";
+	ofstream out(tempname, ios::out | ios::binary | ios::trunc);
+	StatCount(COUNT_FILEOPENS, 1);
+	
+	if (!out.good())
+		return false;
+	
+	out.write((const char*) &header, sizeof(header));
+	
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		uint32_t numpositions = values[i].size();
+		
+		_writekey(out, keys[i]);
+		out.write((const char*) &numpositions, sizeof(uint32_t));
+		
+		for (uint32_t j = 0; j < numpositions; j++)
+		{
+			int64_t pos = values[i][j];
+			out.write((const char*) &pos, sizeof(int64_t));
+		}
+	}
+	
+	out.close();
+	
+	if (!out.good() || rename(tempname.c_str(), filename.c_str()) != 0)
+	{
+		remove(tempname.c_str());
+		return false;
+	}
+	
+	return true;
+}
+
+
+//
+// LoadIndexFile / SaveIndexFile
+//
+// One of each per index key type; type is the column's, so an index of
+// an int column and one of a date column aren't mixed up.
+//
+bool LoadIndexFile(string tablename, string columnname, int column, columntype type, vector<string>& keys, vector<postinglist>& values)
+{
+	return _loadindexfile(tablename, columnname, column, type, keys, values);
+}
+
+bool LoadIndexFile(string tablename, string columnname, int column, columntype type, vector<int64_t>& keys, vector<postinglist>& values)
+{
+	return _loadindexfile(tablename, columnname, column, type, keys, values);
+}
+
+bool LoadIndexFile(string tablename, string columnname, int column, columntype type, vector<double>& keys, vector<postinglist>& values)
+{
+	return _loadindexfile(tablename, columnname, column, type, keys, values);
+}
+
+bool SaveIndexFile(string tablename, string columnname, int column, columntype type, const vector<string>& keys, const vector<postinglist>& values)
+{
+	return _saveindexfile(tablename, columnname, column, type, keys, values);
+}
+
+bool SaveIndexFile(string tablename, string columnname, int column, columntype type, const vector<int64_t>& keys, const vector<postinglist>& values)
+{
+	return _saveindexfile(tablename, columnname, column, type, keys, values);
+}
+
+bool SaveIndexFile(string tablename, string columnname, int column, columntype type, const vector<double>& keys, const vector<postinglist>& values)
+{
+	return _saveindexfile(tablename, columnname, column, type, keys, values);
+}
@@ -0,0 +1,29 @@
+/*indexfile.h*/
+
+// Persistent index sidecar files for myDB project
+
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "postings.h"
+#include "types.h"
+
+using namespace std;
+
+string IndexFileName(string tablename, string columnname);
+
+bool LoadIndexFile(string tablename, string columnname, int column, columntype type, vector<string>& keys, vector<postinglist>& values);
+
+bool LoadIndexFile(string tablename, string columnname, int column, columntype type, vector<int64_t>& keys, vector<postinglist>& values);
+
+bool LoadIndexFile(string tablename, string columnname, int column, columntype type, vector<double>& keys, vector<postinglist>& values);
+
+bool SaveIndexFile(string tablename, string columnname, int column, columntype type, const vector<string>& keys, const vector<postinglist>& values);
+
+bool SaveIndexFile(string tablename, string columnname, int column, columntype type, const vector<int64_t>& keys, const vector<postinglist>& values);
+
+bool SaveIndexFile(string tablename, string columnname, int column, columntype type, const vector<double>& keys, const vector<postinglist>& values);
@@ -9,58 +9,102 @@
 #include <sstream>
 #include <cassert>
 #include <algorithm> //for find and count
+#include <thread>
+#include <cstdlib>
 
-#include "avl.h"
+#include "index.h"
+#include "postings.h"
+#include "query.h"
+#include "server.h"
+#include "table.h"
+#include "types.h"
 #include "util.h"
 
 using namespace std;
 
 
-//
-// tokenize
-//
-// Given a string, breaks the string into individual tokens (words) based
-// on spaces between the tokens.  Returns the tokens back in a vector.
-//
-// Example: "select * from students" would be tokenized into a vector
-// containing 4 strings:  "select", "*", "from", "students".
-//
-vector<string> tokenize(string line)
-{
-  vector<string> tokens;
-  stringstream  stream(line);
-  string token;
-
-  while (getline(stream, token, ' '))
-  {
-    tokens.push_back(token);
-  }
-
-  return tokens;
-}
-
-
-int main()
+int main(int argc, char* argv[])
 {
 	string tablename; // = "students";
-
+	
+	// # of threads for scans of non-indexed columns, one per core by default
+	int numthreads = max(1, (int) thread::hardware_concurrency());
+	
+	// file of queries to run as a batch, instead of prompting for them
+	string batchfilename;
+	
+	// byte budget of the query result cache, 0 to disable it
+	size_t cachebytes = resultcache::DEFAULTBUDGET;
+	
+	// byte budget of the .data buffer pool, 0 to map the file instead
+	size_t poolbytes = 0;
+	
+	// socket to serve queries on, instead of prompting for them
+	string socketpath;
+	
+	// keep a column file per column, so scans read just their column
+	bool columnar = false;
+	
+	// check command line options:
+	//   --threads N   split non-indexed scans across N threads
+	//   --table NAME  open table NAME instead of prompting for it
+	//   --batch FILE  run the queries in FILE (one per line) and exit
+	//   --serve PATH  serve queries on the Unix socket PATH, see server.cpp
+	//   --cache N     cache up to N bytes of query results (0 = no cache)
+	//   --pool N      read the data file through an N byte buffer pool
+	//   --stats       record timings and counters from the start, see stats
+	//   --columnar    scan columns from column files, see columnfile.cpp
+	for (int i = 1; i < argc; i++)
+	{
+		string option = argv[i];
+		
+		if (option == "--threads" && i + 1 < argc)
+			numthreads = max(1, atoi(argv[++i]));
+		else if (option == "--table" && i + 1 < argc)
+			tablename = argv[++i];
+		else if (option == "--batch" && i + 1 < argc)
+			batchfilename = argv[++i];
+		else if (option == "--serve" && i + 1 < argc)
+			socketpath = argv[++i];
+		else if (option == "--cache" && i + 1 < argc)
+			cachebytes = strtoull(argv[++i], nullptr, 10);
+		else if (option == "--pool" && i + 1 < argc)
+			poolbytes = strtoull(argv[++i], nullptr, 10);
+		else if (option == "--stats")
+			StatsEnabled.store(true, memory_order_relaxed);
+		else if (option == "--columnar")
+			columnar = true;
+		else
+		{
+			cout << "**Error: unknown option '" << option << "'." << endl;
+			return 0;
+		}
+	}
+	
 	cout << "Welcome to myDB, please enter tablename> ";
-	getline(cin, tablename);
-
+	if (tablename.empty())
+		getline(cin, tablename);
+	else
+		cout << tablename << endl;
+	
 	
 	// META DATA CODE //
 	cout << "Reading meta-data..." << endl;
 	
+	database db;
 	vector<string> metavect;
-	vector<int> columnvect;
-	vector<string> columnnamevect;
-	vector<string> indexednamevect;
+	vector<int>& columnvect = db.IndexColumns;
+	vector<string>& columnnamevect = db.ColumnNames;
+	vector<columntype>& columntypevect = db.ColumnTypes;
+	vector<string>& indexednamevect = db.IndexNames;
+	vector<indexkind> indexkindvect;
 	int indexcount = 0;
 	
 	// access the respective meta file
 	string metafilename = tablename + ".meta";
 	ifstream metadata(metafilename, ios::in | ios::binary);
-
+	StatCount(COUNT_FILEOPENS, 1);
+	
 	// check if file can be opened
 	if (!metadata.good())
 	{
@@ -68,84 +112,177 @@ int main()
 		return 0;
 	}
 	
-	string metaval;
-	metadata >> metaval;
+	// the record size and # of columns come first, one per line, then a
+	// line per column: its name, 1 if it has an index tree, hash if it has
+	// a hash index, compact if it has a compact index tree (else 0), and an
+	// optional type (int, double, date or string, the default), e.g.
+	// "uin hash int" for a column that is only ever searched for equal
+	// values, or "netid compact" for a string column with a large index
+	string metaline;
 	
-	// loop through each line of meta file
-	while (!metadata.eof())
+	while (getline(metadata, metaline))
 	{
-		// check for 0/1 for indexed/non-indexed columns
-		// push value into respective vectors
-		if (metaval == "0")
+		istringstream metawords(metaline);
+		string metaval, indexed, metatype;
+		
+		if (!(metawords >> metaval))
+			continue;
+		
+		if (metavect.size() < 2)
 		{
-			columnnamevect.push_back(metavect.back());
-			
-			indexcount++;
+			metavect.push_back(metaval);
+			continue;
 		}
-		else if (metaval == "1")
+		
+		metawords >> indexed >> metatype;
+		
+		columntype type = TYPE_STRING;
+		if (!metatype.empty() && !ParseColumnType(metatype, type))
+		{
+			cout << "**Error: unknown type '" << metatype << "' for column '" << metaval << "'." << endl;
+			return 0;
+		}
+		
+		// compact trees only hold string keys
+		if (indexed == "compact" && type != TYPE_STRING)
+		{
+			cout << "**Error: compact index on non-string column '" << metaval << "'." << endl;
+			return 0;
+		}
+		
+		// check for 0/1 for indexed/non-indexed columns
+		// push value into respective vectors
+		if (indexed == "1" || indexed == "hash" || indexed == "compact")
 		{
 			columnvect.push_back(indexcount);
-			columnnamevect.push_back(metavect.back());
-			indexednamevect.push_back(metavect.back());
+			indexednamevect.push_back(metaval);
 			
-			indexcount++;
+			if (indexed == "hash")
+				indexkindvect.push_back(INDEX_HASH);
+			else if (indexed == "compact")
+				indexkindvect.push_back(INDEX_COMPACT);
+			else
+				indexkindvect.push_back(INDEX_TREE);
 		}
 		
-		metavect.push_back(metaval);
+		columnnamevect.push_back(metaval);
+		columntypevect.push_back(type);
 		
-		metadata >> metaval;
+		indexcount++;
 	}
 	
 	
 	// INDEX TREE CODE //
 	cout << "Building index tree(s)..." << endl;
 	
-	// access the respective data file
+	int numspaces = stoi(metavect[0]); 
+	int numcolumns = stoi(metavect[1]);
+	vector<columnindex>& treevect = db.Trees;
+	
+	db.TableName = tablename;
+	db.RecordSize = numspaces;
+	db.NumColumns = numcolumns;
+	db.IndexesChanged = false;
+	db.NumThreads = numthreads;
+	db.Version = 0;
+	db.SpatialVersion = 0;
+	db.Cache.setbudget(cachebytes);
+	
+	// map the respective data file once, every lookup reads from the mapping
 	string datafilename = tablename + ".data";
-	ifstream data(datafilename, ios::in | ios::binary);
+	datatable& table = db.Table;
 	
 	// check if file can be opened
-	if (!data.good())
+	if (!table.open(tablename, numspaces, numcolumns, poolbytes))
 	{
 		cout << "**Error: couldn't open data file '" << datafilename << "'." << endl;
 		return 0;
 	}
 	
-	string key, temp;
-	streamoff value;
-	int numspaces = stoi(metavect[0]); 
-	int numcolumns = stoi(metavect[1]);
-	int linecount = 0;
-	vector<string> recorddata;
-	vector<avltree<string, streamoff>> treevect;
-	
-	// loop through each line of data file (for line count)
-	while (!data.eof())
+	// open every column file, first rebuilding any that are missing or
+	// stale in a single pass over the data file
+	if (columnar)
 	{
-		getline(data, temp);
-		linecount++;
+		vector<columnfile> columnfiles(columnnamevect.size());
+		vector<int> stalecolumns;
+		vector<string> stalenames;
+		
+		db.Columns.swap(columnfiles);
+		
+		for (int i = 0; i < (int) columnnamevect.size(); i++)
+		{
+			if (!db.Columns[i].open(tablename, columnnamevect[i], i, table))
+			{
+				stalecolumns.push_back(i);
+				stalenames.push_back(columnnamevect[i]);
+			}
+		}
+		
+		if (!stalecolumns.empty())
+		{
+			BuildColumnFiles(table, tablename, stalenames, stalecolumns);
+			
+			for (size_t i = 0; i < stalecolumns.size(); i++)
+				db.Columns[stalecolumns[i]].open(tablename, stalenames[i], stalecolumns[i], table);
+		}
+		
+		for (int i = 0; i < (int) columnnamevect.size(); i++)
+		{
+			if (db.Columns[i].good())
+				cout << "Column file: " << columnnamevect[i] << " (" << db.Columns[i].width() + 1 << " bytes per record)" << endl;
+		}
 	}
 	
-	// loop through column index vector
-	size_t numindices = columnvect.size();
-	for (size_t i = 0; i < numindices; i++)
+	// load or rebuild every index, timed as the startup index build
 	{
-		avltree<string, streamoff> indextree;
+		scopedtimer buildtimer(TIME_INDEXBUILD);
+		
+		// one index per indexed column, keyed by the column's type, built
+		// in place in the tree vector so no tree is ever copied; hash
+		// indexes build and load the same way
+		size_t numindices = columnvect.size();
+		vector<int> stalecolumns;
+		vector<size_t> staleindices;
+		
+		treevect.reserve(numindices);
+		for (size_t i = 0; i < numindices; i++)
+			treevect.emplace_back(columntypevect[columnvect[i]], indexkindvect[i]);
 		
-		// loop number of lines times
-		for (int j = 0; j < linecount - 1; j++)
+		// load each index from its index file, unless the file is missing or
+		// stale (the data file changed since it was written)
+		for (size_t i = 0; i < numindices; i++)
 		{
-			value = j * numspaces;
-			// call GetRecord to get record data at each line
-			recorddata = GetRecord(tablename, value, numcolumns);
-			key = recorddata[columnvect[i]];
+			if (!treevect[i].load(tablename, columnnamevect[columnvect[i]], columnvect[i]))
+			{
+				stalecolumns.push_back(columnvect[i]);
+				staleindices.push_back(i);
+			}
+		}
+		
+		// read every stale indexed column in a single pass over the data file
+		if (!stalecolumns.empty())
+		{
+			vector<vector<pair<string, streamoff>>> indexcolumns;
+			indexcolumns = ReadIndexColumns(table, stalecolumns);
 			
-			// insert the indexed column value into avl tree for searching
- 			indextree.insert(key, value);
+			for (size_t i = 0; i < staleindices.size(); i++)
+			{
+				size_t j = staleindices[i];
+				
+				// build the balanced tree straight from the sorted column
+				treevect[j].build(indexcolumns[i]);
+				
+				// save for next time, a failed save just means rebuilding again
+				treevect[j].save(tablename, columnnamevect[columnvect[j]], columnvect[j]);
+			}
 		}
 		
-		// push indexed column tree into tree vector to track each column's data
- 		treevect.push_back(indextree);
+		// searches go to read-only snapshots of the trees
+		FreezeIndexes(db);
+		
+		// and box/nearest searches to the spatial index, if there are
+		// latitude and longitude columns
+		BuildSpatialIndex(db);
 	}
 	
 	// loop through tree vector
@@ -153,191 +290,102 @@ int main()
 	for (size_t i = 0; i < treevectsize; i++)
 	{
 		cout << "Index column: " << columnnamevect[columnvect[i]] << endl;
-		cout << "\tTree size: " << treevect[i].size() << endl;
-		cout << "\tTree height: " << treevect[i].height() << endl;
+		if (treevect[i].type() != TYPE_STRING)
+			cout << "\tKey type: " << ColumnTypeName(treevect[i].type()) << endl;
+		if (treevect[i].kind() == INDEX_HASH)
+		{
+			cout << "\tHash size: " << treevect[i].size() << endl;
+			cout << "\tLongest probe: " << treevect[i].height() << endl;
+		}
+		else
+		{
+			cout << "\tTree size: " << treevect[i].size() << endl;
+			cout << "\tTree height: " << treevect[i].height() << endl;
+		}
 	}
-
+	
+	if (db.LatitudeColumn >= 0)
+	{
+		cout << "Spatial index: " << columnnamevect[db.LatitudeColumn] << ", " << columnnamevect[db.LongitudeColumn] << endl;
+		cout << "\tPoints: " << db.Spatial.size() << endl;
+		cout << "\tTree height: " << db.Spatial.height() << endl;
+	}
+	
 	// QUERY CODE //
 	//
-	// Main loop to input and execute queries from the user:
+	// Batch mode, run every query in the file together:
 	//
-	string query, columnname1, columnname2, searchval;
-	streamoff searchpos;
-	vector<string> searchvect;
-	vector<string>::iterator finditerator;
-	int index;
-	
-	// continuous while loop until user query exit
-	while (true)
-	{	
-		cout << endl;
-		cout << "Enter query> ";
-		getline(cin, query);
-		
-		if (query == "exit")
-			break;
-		
-		// call tokenize to push query into a vector
-		vector<string> tokens = tokenize(query);
-		// declare boolean to check if query value was found or not
-		bool checkval = false;
+	if (!batchfilename.empty())
+	{
+		ifstream batchfile(batchfilename);
 		
-		// check if first query word is select
-		if (tokens.front() != "select")
-		{
-			cout << "Unknown query, ignored...\n";
-			continue;
-		}
-	
-		// these erase statements are used for:
-		// - checking correct number of query words
-		// - progressing through the query vector
-		tokens.erase(tokens.begin());
-
-		// check if selection column is valid (column name or *)
-		columnname1 = tokens.front();
-		if ( (columnname1 != "*") &&
-			 (count(columnnamevect.begin(), columnnamevect.end(), columnname1) == 0) )
+		if (!batchfile.good())
 		{
-			cout << "Invalid select column, ignored...\n";
-			continue;	
-		}
-
-		tokens.erase(tokens.begin());
-
-		// check if third query word is from
-		if (tokens.front() != "from")
-		{
-			cout << "Invalid select query, ignored...\n";
-			continue;
+			cout << "**Error: couldn't open batch file '" << batchfilename << "'." << endl;
+			return 0;
 		}
-
-		tokens.erase(tokens.begin());
-
-		// check if the tablename is valid (current file name)
-		if (tokens.front() != tablename)
-		{
-			cout << "Invalid table name, ignored...\n";
-			continue;
-		}
-
-		tokens.erase(tokens.begin());
 		
-		// check if the fifth query word is where
-		if (tokens.front() != "where")
-		{
-			cout << "Invalid select query, ignored...\n";
-			continue;
-		}
-
-		tokens.erase(tokens.begin());
+		vector<string> queries;
+		string line;
 		
-		// check if search column is valid (meta data columns)
-		columnname2 = tokens.front();
-		if (count(columnnamevect.begin(), columnnamevect.end(), columnname2) == 0) 
+		// one query per line, skipping blank lines and stopping at exit
+		while (getline(batchfile, line))
 		{
-			cout << "Invalid where column, ignored...\n";
-			continue;	
+			if (!line.empty() && line.back() == '\r')
+				line.pop_back();
+			
+			if (line == "exit")
+				break;
+			
+			if (!line.empty())
+				queries.push_back(line);
 		}
 		
-		tokens.erase(tokens.begin());
-		
-		// check if seventh query word is =
-		if (tokens.front() != "=") 
-		{
-			cout << "Invalid select query, ignored...\n";
-			continue;	
-		}
+		cout << endl;
+		ExecuteBatch(db, queries, cout);
 		
-		tokens.erase(tokens.begin());
+		if (db.IndexesChanged)
+			SaveIndexes(db);
 		
-		searchval = tokens.front();
+		return 0;
+	}
+	
+	//
+	// Server mode, answer queries from clients until one shuts it down:
+	//
+	if (!socketpath.empty())
+	{
+		cout << endl;
+		RunServer(db, socketpath, numthreads, cout);
 		
-		tokens.erase(tokens.begin());
+		if (db.IndexesChanged)
+			SaveIndexes(db);
 		
-		// check if the query has too many words in it
-		if (!tokens.empty())
-		{
-			cout << "Query too long, ignored...\n";
-			continue;
-		}
+		return 0;
+	}
+	
+	//
+	// Main loop to input and execute queries from the user:
+	//
+	string query;
+	
+	// continuous while loop until user query exit
+	while (true)
+	{	
+		cout << endl;
+		cout << "Enter query> ";
+		getline(cin, query);
 		
-		// compare if the search column is indexed or not
-		if (count(indexednamevect.begin(), indexednamevect.end(), columnname2) != 0)
-		{
-			// use find multiple times to find the index of a given column name in a vector
-			finditerator = find(indexednamevect.begin(), indexednamevect.end(), columnname2);
-			index = distance(indexednamevect.begin(), finditerator);
-			
-			// check respective avl tree if search value exists in tree
-			if (treevect[index].search(searchval) != nullptr)
-			{
-				// set boolean true since value was found
-				checkval = true;
-
-				searchpos = *treevect[index].search(searchval);
-				searchvect = GetRecord(tablename, searchpos, stoi(metavect[1]));
-				
-				// compare if a column or all columns are specified
-				if (columnname1 == "*")
-				{
-					// loop through the search record data vector
-					size_t searchvectsize = searchvect.size();
-					for (size_t i = 0; i < searchvectsize; i++)
-						cout << columnnamevect[i] << ": " << searchvect[i] << endl;
-				}
-				else
-				{
-					finditerator = find(columnnamevect.begin(), columnnamevect.end(), columnname1);
-					index = distance(columnnamevect.begin(), finditerator);
-
-					cout << columnnamevect[index] << ": " << searchvect[index] << endl;
-				}
-			}
-			
-		}
-		else
-		{
-			vector<streamoff> posvect;
-			vector<string> noindexrecorddata;
-			finditerator = find(columnnamevect.begin(), columnnamevect.end(), columnname2);
-			index = distance(columnnamevect.begin(), finditerator);
-			
-			// call LinearSearch to search for search value in non-indexed columns
-			posvect = LinearSearch(tablename, numspaces, numcolumns, searchval, index);
-			
-			// loop trough position vector
-			size_t posvectsize = posvect.size();
-			for (size_t i = 0; i < posvectsize; i++)
-			{
-				// set boolean true since value was found
-				checkval = true;
-				
-				// call GetRecord to get non-indexed record data at each line
-				noindexrecorddata = GetRecord(tablename, posvect[i], numcolumns);
-				
-				// compare if a column or all columns are specified
-				if (columnname1 == "*")
-				{
-					// loop through the non-indexed search record data vector
-					for (size_t l = 0; l < noindexrecorddata.size(); l++)
-						cout << columnnamevect[l] << ": " << noindexrecorddata[l] << endl;
-				}
-				else
-				{
-					finditerator = find(columnnamevect.begin(), columnnamevect.end(), columnname1);
-					index = distance(columnnamevect.begin(), finditerator);
-
-					cout << columnnamevect[index] << ": " << noindexrecorddata[index] << endl;
-				}
-			}
-		}
+		if (query == "exit")
+			break;
 		
-		// check if search value was not found
-		if (!checkval)
-				cout << "Not found...\n";
+		ExecuteQuery(db, query, cout);
 	}
-
+	
+	// save index trees changed by queries, so next startup can load them
+	if (db.IndexesChanged)
+		SaveIndexes(db);
+	
 	//
 	// done:
 	//
@@ -0,0 +1,76 @@
+/*parallel.h*/
+
+// Multi-threaded passes over a table's records for myDB project
+
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+using namespace std;
+
+//
+// SplitRecords
+//
+// Runs one pass over records [0, numRecords) on up to numThreads
+// threads: the records are split into contiguous ranges, range(first,
+// last) computes a partial result for each on its own thread, and the
+// partial results are folded into a copy of initial with
+// merge(result, part) in record order, so a merge that appends keeps
+// file order.  Small tables, too small to be worth starting threads
+// for, are done in one range on the calling thread.
+//
+//   vector<streamoff> matches = SplitRecords(numrecords, numThreads, vector<streamoff>(),
+//       [&](streamoff first, streamoff last) { return ScanColumn(table, pred, column, first, last); },
+//       [](vector<streamoff>& result, const vector<streamoff>& part) { result.insert(result.end(), part.begin(), part.end()); });
+//
+template<typename TResult, typename TRange, typename TMerge>
+TResult SplitRecords(streamoff numRecords, int numThreads, const TResult& initial, TRange range, TMerge merge)
+{
+	// not worth starting threads for less than this many records each
+	const streamoff minrecordsperthread = 65536;
+	
+	streamoff maxthreads = max((streamoff) 1, numRecords / minrecordsperthread);
+	int threadcount = (int) min((streamoff) max(numThreads, 1), maxthreads);
+	
+	if (threadcount == 1)
+		return range(0, numRecords);
+	
+	vector<TResult> parts(threadcount, initial);
+	vector<thread> workers;
+	
+	// start a worker for each range of records...
+	for (int i = 0; i < threadcount; i++)
+	{
+		streamoff first = numRecords * i / threadcount;
+		streamoff last = numRecords * (i + 1) / threadcount;
+		
+		workers.push_back(thread([&parts, &range, first, last, i]()
+		{
+			parts[i] = range(first, last);
+		}));
+	}
+	
+	// wait for every worker, then merge their results in record order...
+	TResult result = initial;
+	
+	for (int i = 0; i < threadcount; i++)
+	{
+		workers[i].join();
+		merge(result, parts[i]);
+	}
+	
+	return result;
+}
+
+//
+// AppendRange
+//
+// Merge for SplitRecords of record positions: appends a range's matches.
+//
+inline void AppendRange(vector<streamoff>& result, const vector<streamoff>& part)
+{
+	result.insert(result.end(), part.begin(), part.end());
+}
@@ -0,0 +1,231 @@
+/*pool.cpp*/
+
+// Buffer pool of .data file pages for myDB project
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+#include <unistd.h>
+
+#include "pool.h"
+
+using namespace std;
+
+
+// constructor
+bufferpool::bufferpool(int fd, size_t pageSize, size_t budget)
+{
+	size_t numframes = max(budget / pageSize, (size_t) MINFRAMES);
+	
+	Fd = fd;
+	PageSize = pageSize;
+	Memory.resize(numframes * pageSize);
+	Hand = 0;
+	Hits = 0;
+	Misses = 0;
+	Evictions = 0;
+	
+	FRAME empty;
+	empty.Page = -1;
+	empty.Pins = 0;
+	empty.Referenced = false;
+	empty.Loading = false;
+	
+	Frames.assign(numframes, empty);
+}
+
+
+//
+// _victim
+//
+// Returns an unpinned frame to read a page into, emptying it if it holds
+// a page.  Free frames are used first; otherwise the CLOCK hand sweeps
+// until it finds an unpinned frame that hasn't been used since its last
+// pass.  If every frame is pinned, waits for an unpin.
+//
+size_t bufferpool::_victim(unique_lock<mutex>& guard)
+{
+	while (true)
+	{
+		// two passes clear every reference bit, so an unpinned frame is
+		// found in the second if there is one
+		for (size_t step = 0; step < 2 * Frames.size(); step++)
+		{
+			size_t frame = Hand;
+			Hand = (Hand + 1) % Frames.size();
+			
+			if (Frames[frame].Pins > 0)
+				continue;
+			
+			if (Frames[frame].Referenced)
+			{
+				Frames[frame].Referenced = false;
+				continue;
+			}
+			
+			if (Frames[frame].Page >= 0)
+			{
+				PageTable.erase(Frames[frame].Page);
+				Frames[frame].Page = -1;
+				Evictions++;
+			}
+			
+			return frame;
+		}
+		
+		Unpinned.wait(guard);
+	}
+}
+
+
+//
+// pin
+//
+// Returns the page's data (page # times the page size is its offset in
+// the file), reading it into a frame first if it isn't resident.  The
+// data stays valid until the matching unpin.  Bytes past the end of the
+// file read as 0.
+//
+// The frame is claimed (pinned, in the page table and marked Loading)
+// before the lock is released for the read, so the page is read once
+// however many threads pin it meanwhile: they find the frame and wait
+// for it to finish loading.
+//
+const char* bufferpool::pin(streamoff page)
+{
+	unique_lock<mutex> guard(Lock);
+	
+	unordered_map<streamoff, size_t>::iterator found = PageTable.find(page);
+	
+	if (found != PageTable.end())
+	{
+		size_t frame = found->second;
+		
+		Frames[frame].Pins++;
+		Frames[frame].Referenced = true;
+		Hits++;
+		
+		// pinned, so it stays this page's frame while we wait
+		Loaded.wait(guard, [this, frame]() { return !Frames[frame].Loading; });
+		
+		return &Memory[frame * PageSize];
+	}
+	
+	Misses++;
+	
+	size_t frame = _victim(guard);
+	char* data = &Memory[frame * PageSize];
+	
+	Frames[frame].Page = page;
+	Frames[frame].Pins = 1;
+	Frames[frame].Referenced = true;
+	Frames[frame].Loading = true;
+	PageTable[page] = frame;
+	
+	guard.unlock();
+	
+	// read the page, a short read at the end of the file is zero filled
+	ssize_t n = pread(Fd, data, PageSize, page * PageSize);
+	
+	if (n < 0)
+		n = 0;
+	
+	memset(data + n, 0, PageSize - n);
+	
+	guard.lock();
+	
+	Frames[frame].Loading = false;
+	Loaded.notify_all();
+	
+	return data;
+}
+
+
+//
+// unpin
+//
+// Releases one pin of a resident page.
+//
+void bufferpool::unpin(streamoff page)
+{
+	lock_guard<mutex> guard(Lock);
+	
+	unordered_map<streamoff, size_t>::iterator found = PageTable.find(page);
+	
+	if (found != PageTable.end() && Frames[found->second].Pins > 0)
+	{
+		Frames[found->second].Pins--;
+		
+		if (Frames[found->second].Pins == 0)
+			Unpinned.notify_one();
+	}
+}
+
+
+//
+// write
+//
+// Copies bytes just written to the file at offset into every resident
+// page they overlap, so the pool never serves stale data.  Pages that
+// aren't resident are read fresh from the file when next pinned.  A page
+// still loading may have been read before the write, so its load is
+// waited out and the bytes copied over it.
+//
+void bufferpool::write(streamoff offset, const char* data, size_t length)
+{
+	unique_lock<mutex> guard(Lock);
+	
+	streamoff end = offset + length;
+	
+	for (streamoff page = offset / PageSize; page * (streamoff) PageSize < end; page++)
+	{
+		unordered_map<streamoff, size_t>::iterator found = PageTable.find(page);
+		
+		// the frame may be evicted once its load is done, so look again
+		while (found != PageTable.end() && Frames[found->second].Loading)
+		{
+			Loaded.wait(guard);
+			found = PageTable.find(page);
+		}
+		
+		if (found == PageTable.end())
+			continue;
+		
+		streamoff pagestart = page * PageSize;
+		streamoff first = max(offset, pagestart);
+		streamoff last = min(end, pagestart + (streamoff) PageSize);
+		
+		memcpy(&Memory[found->second * PageSize] + (first - pagestart), data + (first - offset), last - first);
+	}
+}
+
+
+// resident function (# of pages in frames)
+size_t bufferpool::resident() const
+{
+	lock_guard<mutex> guard(Lock);
+	return PageTable.size();
+}
+
+// hits function (# of pins that found their page resident)
+uint64_t bufferpool::hits() const
+{
+	lock_guard<mutex> guard(Lock);
+	return Hits;
+}
+
+// misses function (# of pins that had to read their page)
+uint64_t bufferpool::misses() const
+{
+	lock_guard<mutex> guard(Lock);
+	return Misses;
+}
+
+// evictions function (# of pages dropped to make room)
+uint64_t bufferpool::evictions() const
+{
+	lock_guard<mutex> guard(Lock);
+	return Evictions;
+}
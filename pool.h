@@ -0,0 +1,83 @@
+/*pool.h*/
+
+// Buffer pool of .data file pages for myDB project
+
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+using namespace std;
+
+//
+// bufferpool
+//
+// Caches fixed-size pages of an open file in a fixed number of frames
+// (the memory budget divided by the page size).  A page is read from the
+// file the first time it is pinned, and stays in its frame at least
+// until every pin is released:
+//
+//   const char* data = pool.pin(page);  ...read data...  pool.unpin(page);
+//
+// When a page has to be read and every frame is taken, a victim is picked
+// with the CLOCK algorithm: the hand sweeps the frames, skipping pinned
+// ones and giving recently used ones a second chance.  A pin that finds
+// its page already resident costs one uncontended lock and a hash lookup,
+// no system call.  The read of a missing page happens outside the lock,
+// so it doesn't hold up pins of other pages; pins of the same page wait
+// for it.  All functions are safe to call from many threads.
+//
+class bufferpool
+{
+private:
+	struct FRAME
+	{
+		streamoff Page;   // page held, -1 if free
+		int Pins;
+		bool Referenced;  // used since the hand last passed
+		bool Loading;     // being read from the file, see Loaded
+	};
+	
+	int Fd;
+	size_t PageSize;
+	vector<char> Memory;  // frame i is at Memory[i * PageSize]
+	vector<FRAME> Frames;
+	unordered_map<streamoff, size_t> PageTable; // page -> frame
+	size_t Hand;
+	
+	mutable mutex Lock;
+	condition_variable Unpinned;
+	condition_variable Loaded;  // a frame finished loading
+	
+	uint64_t Hits;
+	uint64_t Misses;
+	uint64_t Evictions;
+	
+	size_t _victim(unique_lock<mutex>& guard);
+	
+	// no copies, pins point into the frames
+	bufferpool(const bufferpool& other);
+	bufferpool& operator=(const bufferpool& other);
+	
+public:
+	// fewest frames a pool gets, whatever its budget, so concurrent
+	// readers holding a pin each don't starve
+	static const size_t MINFRAMES = 16;
+	
+	bufferpool(int fd, size_t pageSize, size_t budget);
+	
+	const char* pin(streamoff page);
+	void unpin(streamoff page);
+	void write(streamoff offset, const char* data, size_t length);
+	
+	size_t pagesize() const { return PageSize; }
+	size_t frames() const { return Frames.size(); }
+	size_t resident() const;
+	uint64_t hits() const;
+	uint64_t misses() const;
+	uint64_t evictions() const;
+};
@@ -0,0 +1,170 @@
+/*postings.h*/
+
+// Posting lists (record positions per index key) for myDB project
+
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+
+using namespace std;
+
+//
+// postinglist
+//
+// The file positions of every record holding one index key, in file
+// order.  Most keys belong to a single record, so the first position is
+// kept inline and only keys with duplicates allocate an overflow vector;
+// an empty list is 16 bytes.
+//
+class postinglist
+{
+private:
+	streamoff First;         // first position, -1 if the list is empty
+	vector<streamoff>* More; // positions after the first, null if none
+	
+public:
+	// default constructor
+	postinglist()
+	{
+		First = -1;
+		More = nullptr;
+	}
+	
+	// constructor (list holding one position)
+	postinglist(streamoff pos)
+	{
+		First = pos;
+		More = nullptr;
+	}
+	
+	// copy constructor
+	postinglist(const postinglist& other)
+	{
+		First = other.First;
+		More = (other.More == nullptr) ? nullptr : new vector<streamoff>(*other.More);
+	}
+	
+	// copy assignment
+	postinglist& operator=(const postinglist& other)
+	{
+		if (this != &other)
+		{
+			delete More;
+			First = other.First;
+			More = (other.More == nullptr) ? nullptr : new vector<streamoff>(*other.More);
+		}
+		
+		return *this;
+	}
+	
+	// move constructor
+	postinglist(postinglist&& other) noexcept
+	{
+		First = other.First;
+		More = other.More;
+		
+		other.First = -1;
+		other.More = nullptr;
+	}
+	
+	// move assignment
+	postinglist& operator=(postinglist&& other) noexcept
+	{
+		if (this != &other)
+		{
+			delete More;
+			First = other.First;
+			More = other.More;
+			
+			other.First = -1;
+			other.More = nullptr;
+		}
+		
+		return *this;
+	}
+	
+	// destructor
+	~postinglist()
+	{
+		delete More;
+	}
+	
+	// add function (append a position, positions are kept in add order)
+	void add(streamoff pos)
+	{
+		if (First < 0)
+			First = pos;
+		else
+		{
+			if (More == nullptr)
+				More = new vector<streamoff>();
+			
+			More->push_back(pos);
+		}
+	}
+	
+	// remove function (take a position out of the list, if it is there)
+	void remove(streamoff pos)
+	{
+		if (More != nullptr)
+		{
+			vector<streamoff>::iterator it = find(More->begin(), More->end(), pos);
+			
+			if (it != More->end())
+				More->erase(it);
+			else if (First == pos)
+			{
+				// move the next position up to first
+				First = More->front();
+				More->erase(More->begin());
+			}
+			
+			if (More->empty())
+			{
+				delete More;
+				More = nullptr;
+			}
+		}
+		else if (First == pos)
+			First = -1;
+	}
+	
+	// size function (# of positions in list)
+	size_t size() const
+	{
+		if (First < 0)
+			return 0;
+		else if (More == nullptr)
+			return 1;
+		else
+			return 1 + More->size();
+	}
+	
+	// operator[] (position i of the list)
+	streamoff operator[](size_t i) const
+	{
+		return (i == 0) ? First : (*More)[i - 1];
+	}
+	
+	// positions function (copy the positions out into a vector)
+	vector<streamoff> positions() const
+	{
+		vector<streamoff> posvect;
+		
+		for (size_t i = 0; i < size(); i++)
+			posvect.push_back((*this)[i]);
+		
+		return posvect;
+	}
+};
+
+// operator<< (print positions as "p1;p2;...", used by avltree::inorder)
+inline ostream& operator<<(ostream& out, const postinglist& list)
+{
+	for (size_t i = 0; i < list.size(); i++)
+		out << (i == 0 ? "" : ";") << list[i];
+	
+	return out;
+}
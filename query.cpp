@@ -0,0 +1,1616 @@
+/*query.cpp*/
+
+// Query execution for myDB project
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm> //for find and count
+#include <chrono>
+#include <iomanip>
+
+#include "query.h"
+#include "indexfile.h"
+#include "util.h"
+
+using namespace std;
+
+// reads of a changed index tree before it is frozen again
+static const int REFREEZEREADS = 256;
+
+
+//
+// tokenize
+//
+// Given a string, breaks the string into individual tokens (words) based
+// on spaces between the tokens.  Returns the tokens back in a vector.
+//
+// Example: "select * from students" would be tokenized into a vector
+// containing 4 strings:  "select", "*", "from", "students".
+//
+vector<string> tokenize(string line)
+{
+  scopedtimer timer(TIME_TOKENIZE);
+  vector<string> tokens;
+  stringstream  stream(line);
+  string token;
+
+  while (getline(stream, token, ' '))
+  {
+    tokens.push_back(token);
+  }
+
+  return tokens;
+}
+
+
+//
+// FreezeIndexes
+//
+// Takes a fresh frozen snapshot of every index tree; queries search the
+// snapshots until a write changes a tree.
+//
+void FreezeIndexes(database& db)
+{
+	db.Frozen.clear();
+	db.StaleReads.clear();
+	
+	for (size_t i = 0; i < db.Trees.size(); i++)
+	{
+		db.Frozen.push_back(db.Trees[i].freeze());
+		db.StaleReads.push_back(-1);
+	}
+	
+	// versions only ever go up, a snapshot compares against them
+	db.IndexVersions.resize(db.Trees.size(), 0);
+}
+
+
+//
+// BuildSpatialIndex
+//
+// Builds the spatial index of a table with double columns named
+// latitude and longitude, from both columns read in one pass over the
+// data file.  Records whose point isn't a pair of numbers are left out.
+// Tables without those columns get none, LatitudeColumn is -1.
+//
+void BuildSpatialIndex(database& db)
+{
+	vector<string>::iterator latitude = find(db.ColumnNames.begin(), db.ColumnNames.end(), "latitude");
+	vector<string>::iterator longitude = find(db.ColumnNames.begin(), db.ColumnNames.end(), "longitude");
+	
+	db.LatitudeColumn = -1;
+	db.LongitudeColumn = -1;
+	
+	if (latitude == db.ColumnNames.end() || longitude == db.ColumnNames.end())
+		return;
+	
+	int latcolumn = latitude - db.ColumnNames.begin();
+	int loncolumn = longitude - db.ColumnNames.begin();
+	
+	if (db.ColumnTypes[latcolumn] != TYPE_DOUBLE || db.ColumnTypes[loncolumn] != TYPE_DOUBLE)
+		return;
+	
+	vector<int> columns = {latcolumn, loncolumn};
+	vector<vector<pair<string, streamoff>>> values = ReadIndexColumns(db.Table, columns);
+	vector<double> lats, lons;
+	vector<streamoff> positions;
+	
+	// both columns come back in file order, one pair per record
+	for (size_t i = 0; i < values[0].size(); i++)
+	{
+		const string& latvalue = values[0][i].first;
+		const string& lonvalue = values[1][i].first;
+		double lat, lon;
+		
+		if (ParseValue(latvalue.data(), latvalue.size(), TYPE_DOUBLE, lat) &&
+			ParseValue(lonvalue.data(), lonvalue.size(), TYPE_DOUBLE, lon))
+		{
+			lats.push_back(lat);
+			lons.push_back(lon);
+			positions.push_back(values[0][i].second);
+		}
+	}
+	
+	db.LatitudeColumn = latcolumn;
+	db.LongitudeColumn = loncolumn;
+	db.Spatial.build(lats, lons, positions);
+}
+
+
+//
+// _recordpoint
+//
+// Reads the (latitude, longitude) of the record at pos for the spatial
+// index, pinning the record while it does.  Returns false if the table
+// has no spatial index or the record's point isn't a pair of numbers.
+//
+static bool _recordpoint(const database& db, streamoff pos, double& lat, double& lon)
+{
+	if (db.LatitudeColumn < 0)
+		return false;
+	
+	recordpin pin(db.Table, pos);
+	fieldview latfield = db.Table.column(pos, db.LatitudeColumn);
+	fieldview lonfield = db.Table.column(pos, db.LongitudeColumn);
+	
+	return ParseValue(latfield.Data, latfield.Length, TYPE_DOUBLE, lat) &&
+		   ParseValue(lonfield.Data, lonfield.Length, TYPE_DOUBLE, lon);
+}
+
+
+//
+// _changedindex
+//
+// Notes that a write changed index tree i, so its snapshot is stale.
+//
+static void _changedindex(database& db, size_t i)
+{
+	db.StaleReads[i] = 0;
+	db.IndexVersions[i]++;
+	db.IndexesChanged = true;
+}
+
+
+//
+// _changedtable
+//
+// Notes that a write changed the table's records, so every cached
+// result computed before it is stale.
+//
+static void _changedtable(database& db)
+{
+	db.Version++;
+	
+	// the column files were written along with it, and need restamping
+	if (!db.Columns.empty())
+		db.IndexesChanged = true;
+}
+
+
+//
+// _parsewhere
+//
+// Parses "where col op value" off the front of the remaining query
+// tokens into the where column and predicate, where op is one of
+//   = < <= > >= value, between value and value, like prefix%
+// The predicate compares as the where column's type, so its values must
+// be valid for the type, and like only applies to string columns.
+// Prints the reason and returns false if the clause is invalid; kind
+// ("select", "delete") names the query in the message.
+//
+static bool _parsewhere(const database& db, string kind, vector<string>& tokens,
+						string& columnname, predicate& pred, ostream& output)
+{
+	// check if the where query word is there
+	if (tokens.empty() || tokens.front() != "where")
+	{
+		output << "Invalid " << kind << " query, ignored...\n";
+		return false;
+	}
+
+	tokens.erase(tokens.begin());
+	
+	// check if search column is valid (meta data columns)
+	if (tokens.empty() || count(db.ColumnNames.begin(), db.ColumnNames.end(), tokens.front()) == 0) 
+	{
+		output << "Invalid where column, ignored...\n";
+		return false;	
+	}
+	
+	columnname = tokens.front();
+	
+	tokens.erase(tokens.begin());
+	
+	// check the next two query words for the comparison and value
+	if (tokens.size() < 2)
+	{
+		output << "Invalid " << kind << " query, ignored...\n";
+		return false;	
+	}
+	
+	string op = tokens.front();
+	
+	if (op == "=")
+		pred.Op = OP_EQUAL;
+	else if (op == "<")
+		pred.Op = OP_LESS;
+	else if (op == "<=")
+		pred.Op = OP_LESSEQUAL;
+	else if (op == ">")
+		pred.Op = OP_GREATER;
+	else if (op == ">=")
+		pred.Op = OP_GREATEREQUAL;
+	else if (op == "between")
+		pred.Op = OP_BETWEEN;
+	else if (op == "like")
+		pred.Op = OP_PREFIX;
+	else
+	{
+		output << "Invalid " << kind << " query, ignored...\n";
+		return false;	
+	}
+	
+	tokens.erase(tokens.begin());
+	
+	string searchval = tokens.front();
+	pred.Value = searchval;
+	
+	tokens.erase(tokens.begin());
+	
+	// check between has "and" plus an upper bound
+	if (pred.Op == OP_BETWEEN)
+	{
+		if (tokens.size() < 2 || tokens.front() != "and")
+		{
+			output << "Invalid " << kind << " query, ignored...\n";
+			return false;
+		}
+		
+		tokens.erase(tokens.begin());
+		
+		pred.Value2 = tokens.front();
+		
+		tokens.erase(tokens.begin());
+	}
+	
+	// check like has a prefix pattern (only a trailing % is supported)
+	if (pred.Op == OP_PREFIX)
+	{
+		if (searchval.empty() || searchval.back() != '%' ||
+			searchval.find('%') != searchval.size() - 1)
+		{
+			output << "Only prefix patterns (like value%) are supported, ignored...\n";
+			return false;
+		}
+		
+		pred.Value = searchval.substr(0, searchval.size() - 1);
+	}
+	
+	// check if the query has too many words in it
+	if (!tokens.empty())
+	{
+		output << "Query too long, ignored...\n";
+		return false;
+	}
+	
+	// check the value(s) against the column's type
+	columntype type = db.ColumnTypes[find(db.ColumnNames.begin(), db.ColumnNames.end(), columnname) - db.ColumnNames.begin()];
+	
+	if (!pred.settype(type))
+	{
+		if (pred.Op == OP_PREFIX)
+			output << "Prefix patterns only work on string columns, ignored...\n";
+		else
+			output << "Invalid " << ColumnTypeName(type) << " value for column '" << columnname << "', ignored...\n";
+		return false;
+	}
+	
+	return true;
+}
+
+
+//
+// _columnnumber
+//
+// Returns the column # of a column name, 0-based; the name must be
+// valid.
+//
+static int _columnnumber(const database& db, string columnname)
+{
+	return find(db.ColumnNames.begin(), db.ColumnNames.end(), columnname) - db.ColumnNames.begin();
+}
+
+
+//
+// _indexnumber
+//
+// Returns the index # of an indexed column, -1 if the column isn't
+// indexed.
+//
+static int _indexnumber(const database& db, string columnname)
+{
+	vector<string>::const_iterator finditerator = find(db.IndexNames.begin(), db.IndexNames.end(), columnname);
+	
+	if (finditerator == db.IndexNames.end())
+		return -1;
+	
+	return distance(db.IndexNames.begin(), finditerator);
+}
+
+
+//
+// _columnfile
+//
+// Returns the column file of a column #, null if it has none (the
+// table wasn't opened --columnar, or the file couldn't be kept in sync).
+//
+static const columnfile* _columnfile(const database& db, int column)
+{
+	if (column < (int) db.Columns.size() && db.Columns[column].good())
+		return &db.Columns[column];
+	
+	return nullptr;
+}
+
+
+//
+// _findmatches
+//
+// Returns the positions of the records matching the where clause, from
+// the column's index if it has one that answers the comparison,
+// otherwise by scanning its column file, or the table if it has none.
+//
+static vector<streamoff> _findmatches(database& db, string columnname, const predicate& pred)
+{
+	vector<string>::iterator finditerator;
+	int index = _indexnumber(db, columnname);
+	
+	// compare if the search column is indexed (for this kind of
+	// comparison, a hash index only finds equal values) or not
+	if (index >= 0 && db.Trees[index].answers(pred))
+	{
+		// a current snapshot is searched instead of the tree itself
+		if (db.StaleReads[index] < 0)
+			return db.Frozen[index].search(pred);
+		
+		// after a write the tree is searched directly, and a new snapshot
+		// is taken once enough reads have gone by to pay for it
+		db.StaleReads[index]++;
+		if (db.StaleReads[index] >= REFREEZEREADS)
+		{
+			db.Frozen[index] = db.Trees[index].freeze();
+			db.StaleReads[index] = -1;
+		}
+		
+		// check respective avl tree for the matching keys,
+		// their posting lists hold every matching record
+		return db.Trees[index].search(pred);
+	}
+	else
+	{
+		finditerator = find(db.ColumnNames.begin(), db.ColumnNames.end(), columnname);
+		index = distance(db.ColumnNames.begin(), finditerator);
+		
+		// a column file holds just this column's values, so scan that
+		const columnfile* file = _columnfile(db, index);
+		
+		if (file != nullptr)
+			return ColumnScan(*file, pred, db.NumThreads);
+		
+		// call LinearSearch to search for search value in non-indexed columns
+		return LinearSearch(db.Table, pred, index, db.NumThreads);
+	}
+}
+
+
+// spatial clause in "select ... from <table> within/nearest ..."
+enum spatialclause
+{
+	SPATIAL_NONE,
+	SPATIAL_BOX,     // within box(lat1, lon1, lat2, lon2)
+	SPATIAL_NEAREST  // nearest k to (lat, lon)
+};
+
+//
+// SELECTQUERY
+//
+// A parsed "select <col|*> from <table> where ..." query.
+//
+struct SELECTQUERY
+{
+	string Column;      // selected column, *, or an aggregate fn(col)
+	string WhereColumn;
+	predicate Pred;
+	bool Where;         // false if there is no where clause (aggregates only)
+	bool Aggregate;     // true if Column is fn(col)
+	aggregatefn Function;
+	string AggregateColumn; // col of fn(col), * for count(*)
+	spatialclause Spatial;  // within box or nearest k, instead of a where clause
+	double Lat, Lon;        // nearest point, or one corner of the box
+	double Lat2, Lon2;      // the box's opposite corner
+	size_t NumNearest;
+	
+	SELECTQUERY()
+		: Where(true), Aggregate(false), Function(AGG_COUNT), Spatial(SPATIAL_NONE),
+		  Lat(0), Lon(0), Lat2(0), Lon2(0), NumNearest(0)
+	{
+	}
+};
+
+
+//
+// _parsespatial
+//
+// Parses a spatial clause off the remaining select query tokens, in
+// place of a where clause:
+//   within box(lat1, lon1, lat2, lon2)
+//   nearest k to (lat, lon)
+// Commas and parentheses may be left out.  Prints the reason and
+// returns false if the clause is invalid or the table has no spatial
+// index.
+//
+static bool _parsespatial(const database& db, vector<string>& tokens, SELECTQUERY& select, ostream& output)
+{
+	if (db.LatitudeColumn < 0)
+	{
+		output << "No spatial index, table '" << db.TableName
+			   << "' needs double latitude and longitude columns, ignored...\n";
+		return false;
+	}
+	
+	// split the rest into words, dropping the punctuation
+	string rest;
+	
+	for (size_t i = 0; i < tokens.size(); i++)
+		rest += tokens[i] + " ";
+	
+	replace_if(rest.begin(), rest.end(), [](char c) { return c == '(' || c == ')' || c == ','; }, ' ');
+	
+	vector<string> words;
+	stringstream stream(rest);
+	string word;
+	
+	while (stream >> word)
+		words.push_back(word);
+	
+	// then check the words are "within box n n n n" or "nearest k to n n"
+	vector<double> numbers;
+	int64_t k = 0;
+	size_t first;
+	
+	if (words.size() == 6 && words[0] == "within" && words[1] == "box")
+	{
+		select.Spatial = SPATIAL_BOX;
+		first = 2;
+	}
+	else if (words.size() == 5 && words[0] == "nearest" && words[2] == "to" &&
+			 ParseValue(words[1].data(), words[1].size(), TYPE_INT, k) && k > 0)
+	{
+		select.Spatial = SPATIAL_NEAREST;
+		select.NumNearest = (size_t) k;
+		first = 3;
+	}
+	else
+	{
+		output << "Invalid within/nearest clause, ignored...\n";
+		return false;
+	}
+	
+	for (size_t i = first; i < words.size(); i++)
+	{
+		double number;
+		
+		if (!ParseValue(words[i].data(), words[i].size(), TYPE_DOUBLE, number))
+		{
+			output << "Invalid latitude/longitude '" << words[i] << "', ignored...\n";
+			return false;
+		}
+		
+		numbers.push_back(number);
+	}
+	
+	select.Where = false;
+	select.Lat = numbers[0];
+	select.Lon = numbers[1];
+	
+	if (select.Spatial == SPATIAL_BOX)
+	{
+		select.Lat2 = numbers[2];
+		select.Lon2 = numbers[3];
+	}
+	
+	return true;
+}
+
+
+//
+// _parseselect
+//
+// Parses a select query's tokens; prints the reason and returns false
+// if the query is invalid.  The selected column may be an aggregate,
+// count(*), min(col), max(col), sum(col) or avg(col), and then the
+// where clause is optional.  A spatial clause (within box, nearest k,
+// see _parsespatial) may take the place of the where clause.
+//
+static bool _parseselect(const database& db, vector<string>& tokens, SELECTQUERY& select, ostream& output)
+{
+	// these erase statements are used for:
+	// - checking correct number of query words
+	// - progressing through the query vector
+	tokens.erase(tokens.begin());
+
+	// check for an aggregate, and that its column is valid
+	if (!tokens.empty() && ParseAggregate(tokens.front(), select.Function, select.AggregateColumn))
+	{
+		select.Aggregate = true;
+		
+		if (select.AggregateColumn != "*" &&
+			count(db.ColumnNames.begin(), db.ColumnNames.end(), select.AggregateColumn) == 0)
+		{
+			output << "Invalid select column, ignored...\n";
+			return false;
+		}
+		
+		// sums and averages need numbers
+		if ((select.Function == AGG_SUM || select.Function == AGG_AVG) &&
+			db.ColumnTypes[_columnnumber(db, select.AggregateColumn)] != TYPE_INT &&
+			db.ColumnTypes[_columnnumber(db, select.AggregateColumn)] != TYPE_DOUBLE)
+		{
+			output << "sum and avg only work on int and double columns, ignored...\n";
+			return false;
+		}
+	}
+	// check if selection column is valid (column name or *)
+	else if ( tokens.empty() || ((tokens.front() != "*") &&
+		 (count(db.ColumnNames.begin(), db.ColumnNames.end(), tokens.front()) == 0)) )
+	{
+		output << "Invalid select column, ignored...\n";
+		return false;	
+	}
+	
+	select.Column = tokens.front();
+
+	tokens.erase(tokens.begin());
+
+	// check if third query word is from
+	if (tokens.empty() || tokens.front() != "from")
+	{
+		output << "Invalid select query, ignored...\n";
+		return false;
+	}
+
+	tokens.erase(tokens.begin());
+
+	// check if the tablename is valid (current file name)
+	if (tokens.empty() || tokens.front() != db.TableName)
+	{
+		output << "Invalid table name, ignored...\n";
+		return false;
+	}
+
+	tokens.erase(tokens.begin());
+	
+	if (!tokens.empty() && (tokens.front() == "within" || tokens.front() == "nearest"))
+		return _parsespatial(db, tokens, select, output);
+	
+	// an aggregate without a where clause covers every record
+	if (select.Aggregate && tokens.empty())
+	{
+		select.Where = false;
+		return true;
+	}
+	
+	return _parsewhere(db, "select", tokens, select.WhereColumn, select.Pred, output);
+}
+
+
+//
+// _printmatches
+//
+// Outputs the selected column (or all columns) of each matching record,
+// read from the given table (the database's own, or a snapshot's).
+//
+static void _printmatches(const database& db, const datatable& table, string columnname,
+						  const vector<streamoff>& posvect, ostream& output)
+{
+	vector<string>::const_iterator finditerator;
+	int index;
+	// declare boolean to check if query value was found or not
+	bool checkval = false;
+	vector<string> recorddata;
+	
+	// loop trough position vector
+	size_t posvectsize = posvect.size();
+	for (size_t i = 0; i < posvectsize; i++)
+	{
+		// set boolean true since value was found
+		checkval = true;
+		
+		// call GetRecord to get the record data at each match
+		recorddata = GetRecord(table, posvect[i]);
+		
+		// compare if a column or all columns are specified
+		if (columnname == "*")
+		{
+			// loop through the search record data vector
+			for (size_t l = 0; l < recorddata.size(); l++)
+				output << db.ColumnNames[l] << ": " << recorddata[l] << endl;
+		}
+		else
+		{
+			finditerator = find(db.ColumnNames.begin(), db.ColumnNames.end(), columnname);
+			index = distance(db.ColumnNames.begin(), finditerator);
+
+			output << db.ColumnNames[index] << ": " << recorddata[index] << endl;
+		}
+	}
+	
+	// check if search value was not found
+	if (!checkval)
+			output << "Not found...\n";
+}
+
+
+//
+// _spatialmatches
+//
+// Returns the positions of the records a spatial select matches, from
+// the given spatial index and table (the database's own, or a
+// snapshot's): the ones inside the box in file order, or the nearest k
+// nearest first, with their distances in km.  Records deleted since
+// the index was copied are left out, so a snapshot's nearest can come
+// up short.
+//
+static vector<streamoff> _spatialmatches(const spatialindex& spatial, const datatable& table,
+										 const SELECTQUERY& select, vector<double>* distances)
+{
+	vector<streamoff> posvect;
+	
+	if (select.Spatial == SPATIAL_BOX)
+	{
+		posvect = spatial.within(select.Lat, select.Lon, select.Lat2, select.Lon2);
+		posvect.erase(remove_if(posvect.begin(), posvect.end(),
+								[&table](streamoff pos) { return table.deleted(pos); }), posvect.end());
+		return posvect;
+	}
+	
+	vector<pair<double, streamoff>> nearest = spatial.nearest(select.NumNearest, select.Lat, select.Lon);
+	
+	for (size_t i = 0; i < nearest.size(); i++)
+	{
+		if (table.deleted(nearest[i].second))
+			continue;
+		
+		posvect.push_back(nearest[i].second);
+		
+		if (distances != nullptr)
+			distances->push_back(nearest[i].first);
+	}
+	
+	return posvect;
+}
+
+
+//
+// _spatialselect
+//
+// Outputs the matches of a (non-aggregate) spatial select, each of the
+// nearest k followed by its distance.
+//
+static void _spatialselect(const database& db, const spatialindex& spatial, const datatable& table,
+						   const SELECTQUERY& select, ostream& output)
+{
+	vector<double> distances;
+	vector<streamoff> posvect = _spatialmatches(spatial, table, select, &distances);
+	
+	if (select.Spatial == SPATIAL_BOX || posvect.empty())
+	{
+		_printmatches(db, table, select.Column, posvect, output);
+		return;
+	}
+	
+	for (size_t i = 0; i < posvect.size(); i++)
+	{
+		ostringstream distance;
+		distance << fixed << setprecision(3) << distances[i];
+		
+		_printmatches(db, table, select.Column, vector<streamoff>(1, posvect[i]), output);
+		output << "distance: " << distance.str() << " km" << endl;
+	}
+}
+
+
+//
+// _cachekey
+//
+// Returns the result cache key of a parsed select: the table, selected
+// column, where column, comparison and value(s), or spatial clause, so
+// queries that differ only in spacing share a key.
+//
+static string _cachekey(const database& db, const SELECTQUERY& select)
+{
+	ostringstream key;
+	
+	key << db.TableName << ' ' << select.Column << ' ' << select.WhereColumn << ' '
+		<< select.Pred.Op << ' ' << select.Pred.Value << ' ' << select.Pred.Value2;
+	
+	if (select.Spatial != SPATIAL_NONE)
+	{
+		key.precision(17);
+		key << ' ' << select.Spatial << ' ' << select.NumNearest << ' ' << select.Lat << ' '
+			<< select.Lon << ' ' << select.Lat2 << ' ' << select.Lon2;
+	}
+	
+	return key.str();
+}
+
+
+//
+// _indexextreme
+//
+// Adds the min or max of an indexed column to result, from the
+// leftmost or rightmost key of its index (or a snapshot of it) and the
+// first live record in that key's posting list.  Returns false if every
+// one of them has been deleted since the snapshot was taken, or the
+// index is a hash index, and the caller has to scan instead.
+//
+template<typename TIndex>
+static bool _indexextreme(TIndex& index, const datatable& table, int column, aggregate& result)
+{
+	// a hash index has no ends
+	if (index.kind() == INDEX_HASH)
+		return false;
+	
+	const postinglist* postings = (result.Function == AGG_MIN) ? index.first() : index.last();
+	
+	// an empty index means no valid values
+	if (postings == nullptr)
+		return true;
+	
+	recordpin pin;
+	
+	for (size_t i = 0; i < postings->size(); i++)
+	{
+		const char* record = pin.at(table, (*postings)[i]);
+		
+		if (record[0] == '.')
+			continue;
+		
+		fieldview field = FindColumn(record, table.recordsize(), column);
+		result.add(field.Data, field.Length);
+		return true;
+	}
+	
+	return false;
+}
+
+
+//
+// _aggregate
+//
+// Runs an aggregate select and outputs its result.  Without a where
+// clause, min/max of an indexed column come from the ends of its index
+// and everything else from one streaming scan of the column's file (or
+// the table); with one, count on an indexed where column adds up posting
+// list sizes without reading a record, and everything else aggregates
+// the matches.  A spatial clause aggregates the records it matches.
+//
+static void _aggregate(database& db, const SELECTQUERY& select, ostream& output)
+{
+	int column = (select.AggregateColumn == "*") ? 0 : _columnnumber(db, select.AggregateColumn);
+	aggregate result(select.Function, db.ColumnTypes[column]);
+	
+	if (select.Spatial != SPATIAL_NONE)
+		AggregatePositions(db.Table, _spatialmatches(db.Spatial, db.Table, select, nullptr), column, result);
+	else if (!select.Where)
+	{
+		int index = _indexnumber(db, select.AggregateColumn);
+		bool done = false;
+		
+		if ((select.Function == AGG_MIN || select.Function == AGG_MAX) && index >= 0)
+		{
+			if (db.StaleReads[index] < 0)
+				done = _indexextreme(db.Frozen[index], db.Table, column, result);
+			else
+				done = _indexextreme(db.Trees[index], db.Table, column, result);
+		}
+		
+		if (!done && _columnfile(db, column) != nullptr)
+			result = ColumnAggregate(*_columnfile(db, column), result, db.NumThreads);
+		else if (!done)
+			result = ScanAggregate(db.Table, column, result, db.NumThreads);
+	}
+	else
+	{
+		int index = _indexnumber(db, select.WhereColumn);
+		
+		bool indexed = (index >= 0 && db.Trees[index].answers(select.Pred));
+		
+		if (select.Function == AGG_COUNT && indexed && db.StaleReads[index] < 0)
+			result.Count = db.Frozen[index].count(select.Pred);
+		else if (select.Function == AGG_COUNT && indexed)
+			result.Count = db.Trees[index].count(select.Pred);
+		else if (select.Function != AGG_COUNT && _columnfile(db, column) != nullptr)
+			ColumnAggregatePositions(*_columnfile(db, column), _findmatches(db, select.WhereColumn, select.Pred), result);
+		else
+			AggregatePositions(db.Table, _findmatches(db, select.WhereColumn, select.Pred), column, result);
+	}
+	
+	result.print(select.Column, output);
+}
+
+
+//
+// _select
+//
+// Runs "select <col|*> from <table> where ..." and outputs the matches.
+//
+static void _select(database& db, vector<string>& tokens, ostream& output)
+{
+	SELECTQUERY select;
+	
+	if (!_parseselect(db, tokens, select, output))
+		return;
+	
+	// a repeated query is answered from the cache
+	string key = _cachekey(db, select);
+	string result;
+	
+	if (db.Cache.lookup(key, db.Version, result))
+	{
+		output << result;
+		return;
+	}
+	
+	ostringstream matches;
+	
+	if (select.Aggregate)
+		_aggregate(db, select, matches);
+	else if (select.Spatial != SPATIAL_NONE)
+		_spatialselect(db, db.Spatial, db.Table, select, matches);
+	else
+		_printmatches(db, db.Table, select.Column, _findmatches(db, select.WhereColumn, select.Pred), matches);
+	
+	db.Cache.insert(key, db.Version, matches.str());
+	output << matches.str();
+}
+
+
+//
+// _delete
+//
+// Runs "delete from <table> where ...": every matching record is removed
+// from each index tree and then tombstoned in the data file.
+//
+static void _delete(database& db, vector<string>& tokens, ostream& output)
+{
+	string columnname;
+	
+	tokens.erase(tokens.begin());
+
+	// check if second query word is from
+	if (tokens.empty() || tokens.front() != "from")
+	{
+		output << "Invalid delete query, ignored...\n";
+		return;
+	}
+
+	tokens.erase(tokens.begin());
+
+	// check if the tablename is valid (current file name)
+	if (tokens.empty() || tokens.front() != db.TableName)
+	{
+		output << "Invalid table name, ignored...\n";
+		return;
+	}
+
+	tokens.erase(tokens.begin());
+	
+	predicate pred;
+	if (!_parsewhere(db, "delete", tokens, columnname, pred, output))
+		return;
+	
+	vector<streamoff> posvect = _findmatches(db, columnname, pred);
+	
+	if (posvect.empty())
+	{
+		output << "Not found...\n";
+		return;
+	}
+	
+	int numdeleted = 0;
+	
+	for (size_t i = 0; i < posvect.size(); i++)
+	{
+		streamoff pos = posvect[i];
+		vector<string> indexvalues;
+		double lat, lon;
+		bool haspoint;
+		
+		// read the record's indexed values and point first, the tombstone
+		// overwrites the start of the record
+		{
+			recordpin pin(db.Table, pos);
+			
+			for (size_t j = 0; j < db.Trees.size(); j++)
+				indexvalues.push_back(db.Table.column(pos, db.IndexColumns[j]).str());
+			
+			haspoint = _recordpoint(db, pos, lat, lon);
+		}
+		
+		// tombstone the record itself; if that fails it is still live, and
+		// has to stay in the indexes
+		if (!db.Table.erase(pos))
+		{
+			output << "**Error: couldn't write data file '" << db.TableName << ".data'." << endl;
+			break;
+		}
+		
+		// then take it out of every index tree, dropping keys that no
+		// longer have any records, and out of each column file
+		for (size_t j = 0; j < db.Trees.size(); j++)
+		{
+			db.Trees[j].remove(indexvalues[j], pos);
+			
+			_changedindex(db, j);
+		}
+		
+		if (haspoint)
+		{
+			db.Spatial.remove(lat, lon, pos);
+			db.SpatialVersion++;
+		}
+		
+		for (size_t j = 0; j < db.Columns.size(); j++)
+		{
+			if (db.Columns[j].good())
+				db.Columns[j].erase(pos);
+		}
+		
+		numdeleted++;
+	}
+	
+	if (numdeleted > 0)
+		_changedtable(db);
+	
+	output << "Deleted " << numdeleted << " record(s)...\n";
+}
+
+
+//
+// _validvalue
+//
+// True if the value is valid for a column of the given type.
+//
+static bool _validvalue(const string& value, columntype type)
+{
+	int64_t integer;
+	double real;
+	
+	switch (type)
+	{
+		case TYPE_INT:
+		case TYPE_DATE:
+			return ParseValue(value.data(), value.size(), type, integer);
+		case TYPE_DOUBLE:
+			return ParseValue(value.data(), value.size(), type, real);
+		default:
+			return true;
+	}
+}
+
+
+//
+// _insert
+//
+// Runs "insert into <table> values (v1 v2 ...) (v1 v2 ...) ...": each
+// row is padded to the record size, all rows are appended to the data
+// file with a single write, and then each new record is added to every
+// index tree.  Values may also be separated by commas.
+//
+static void _insert(database& db, vector<string>& tokens, ostream& output)
+{
+	tokens.erase(tokens.begin());
+
+	// check if second query word is into
+	if (tokens.empty() || tokens.front() != "into")
+	{
+		output << "Invalid insert query, ignored...\n";
+		return;
+	}
+
+	tokens.erase(tokens.begin());
+
+	// check if the tablename is valid (current file name)
+	if (tokens.empty() || tokens.front() != db.TableName)
+	{
+		output << "Invalid table name, ignored...\n";
+		return;
+	}
+
+	tokens.erase(tokens.begin());
+	
+	// check if fourth query word is values
+	if (tokens.empty() || tokens.front() != "values")
+	{
+		output << "Invalid insert query, ignored...\n";
+		return;
+	}
+
+	tokens.erase(tokens.begin());
+	
+	// split the rest into rows of values: ( starts a row, ) ends it
+	vector<vector<string>> rows;
+	string rest, value;
+	bool inrow = false;
+	
+	for (size_t i = 0; i < tokens.size(); i++)
+		rest += tokens[i] + " ";
+	
+	for (size_t i = 0; i < rest.size(); i++)
+	{
+		char c = rest[i];
+		
+		if (c == '(' && !inrow)
+		{
+			rows.push_back(vector<string>());
+			inrow = true;
+		}
+		else if ((c == ' ' || c == ',' || c == ')') && inrow)
+		{
+			if (!value.empty())
+				rows.back().push_back(value);
+			value.clear();
+			
+			if (c == ')')
+				inrow = false;
+		}
+		else if (inrow && c != '(')
+			value += c;
+		else if (c != ' ' && c != ',')
+		{
+			output << "Invalid insert query, ignored...\n";
+			return;
+		}
+	}
+	
+	if (inrow || rows.empty())
+	{
+		output << "Invalid insert query, ignored...\n";
+		return;
+	}
+	
+	// pad each row like the existing records: values, a space, '.' up to
+	// the line ending
+	string eol = db.Table.lineending();
+	string records;
+	
+	for (size_t i = 0; i < rows.size(); i++)
+	{
+		// check the row has one value per column, and doesn't look deleted
+		if ((int) rows[i].size() != db.NumColumns || rows[i][0][0] == '.')
+		{
+			output << "Invalid values for table '" << db.TableName << "', ignored...\n";
+			return;
+		}
+		
+		string record = rows[i][0];
+		for (size_t j = 1; j < rows[i].size(); j++)
+			record += " " + rows[i][j];
+		
+		// check each value is valid for its column's type
+		for (size_t j = 0; j < rows[i].size(); j++)
+		{
+			const string& value = rows[i][j];
+			
+			if (!_validvalue(value, db.ColumnTypes[j]))
+			{
+				output << "Invalid " << ColumnTypeName(db.ColumnTypes[j]) << " value for column '"
+					   << db.ColumnNames[j] << "', ignored...\n";
+				return;
+			}
+		}
+		
+		if (record.size() + eol.size() > (size_t) db.RecordSize)
+		{
+			output << "Values too long for record size " << db.RecordSize << ", ignored...\n";
+			return;
+		}
+		
+		if (record.size() + eol.size() < (size_t) db.RecordSize)
+			record += " ";
+		
+		record.append(db.RecordSize - eol.size() - record.size(), '.');
+		record += eol;
+		
+		records += record;
+	}
+	
+	// one write for every row of the query
+	streamoff firstpos = db.Table.numrecords() * db.RecordSize;
+	
+	if (!db.Table.append(records))
+	{
+		output << "**Error: couldn't write data file '" << db.TableName << ".data'." << endl;
+		return;
+	}
+	
+	// add the new values to each column file; one that can't take them
+	// (a value wider than its column) is dropped, and rebuilt next startup
+	for (size_t j = 0; j < db.Columns.size(); j++)
+	{
+		vector<string> values;
+		
+		for (size_t i = 0; i < rows.size(); i++)
+			values.push_back(rows[i][j]);
+		
+		if (db.Columns[j].good() && !db.Columns[j].append(values))
+			db.Columns[j].close(true);
+	}
+	
+	_changedtable(db);
+	
+	// add each new record to every index tree under its new position
+	for (size_t i = 0; i < rows.size(); i++)
+	{
+		streamoff pos = firstpos + i * db.RecordSize;
+		
+		double lat, lon;
+		
+		for (size_t j = 0; j < db.Trees.size(); j++)
+		{
+			db.Trees[j].add(rows[i][db.IndexColumns[j]], pos);
+			
+			_changedindex(db, j);
+		}
+		
+		if (_recordpoint(db, pos, lat, lon))
+		{
+			db.Spatial.add(lat, lon, pos);
+			db.SpatialVersion++;
+		}
+	}
+	
+	output << "Inserted " << rows.size() << " record(s)...\n";
+}
+
+
+//
+// _showcache
+//
+// Runs "show cache": outputs the result cache's hit/miss counts and size.
+//
+static void _showcache(database& db, ostream& output)
+{
+	uint64_t lookups = db.Cache.hits() + db.Cache.misses();
+	
+	output << "Cache hits: " << db.Cache.hits() << "\n";
+	output << "Cache misses: " << db.Cache.misses() << "\n";
+	output << "Cache hit rate: " << (lookups > 0 ? 100.0 * db.Cache.hits() / lookups : 0) << "%\n";
+	output << "Cache entries: " << db.Cache.size() << "\n";
+	output << "Cache bytes: " << db.Cache.bytes() << " of " << db.Cache.budget() << "\n";
+}
+
+
+//
+// _showpool
+//
+// Runs "show pool": outputs the buffer pool's hit/miss counts, evictions
+// and size.
+//
+static void _showpool(database& db, ostream& output)
+{
+	const bufferpool* pool = db.Table.pool();
+	
+	if (pool == nullptr)
+	{
+		output << "No buffer pool, the data file is memory-mapped...\n";
+		return;
+	}
+	
+	uint64_t hits = pool->hits();
+	uint64_t misses = pool->misses();
+	
+	output << "Pool hits: " << hits << "\n";
+	output << "Pool misses: " << misses << "\n";
+	output << "Pool hit rate: " << (hits + misses > 0 ? 100.0 * hits / (hits + misses) : 0) << "%\n";
+	output << "Pool evictions: " << pool->evictions() << "\n";
+	output << "Pool pages: " << pool->resident() << " of " << pool->frames()
+		   << " (" << pool->pagesize() << " bytes each)\n";
+}
+
+
+//
+// _stats
+//
+// Runs "stats" (output the timings and counters), "stats on", "stats
+// off" (start or stop recording them) or "stats reset".
+//
+static void _stats(vector<string>& tokens, ostream& output)
+{
+	if (tokens.size() == 1)
+		PrintStats(output);
+	else if (tokens.size() == 2 && tokens[1] == "on")
+	{
+		StatsEnabled.store(true, memory_order_relaxed);
+		output << "Stats on...\n";
+	}
+	else if (tokens.size() == 2 && tokens[1] == "off")
+	{
+		StatsEnabled.store(false, memory_order_relaxed);
+		output << "Stats off...\n";
+	}
+	else if (tokens.size() == 2 && tokens[1] == "reset")
+	{
+		ResetStats();
+		output << "Stats reset...\n";
+	}
+	else
+		output << "Invalid stats query, ignored...\n";
+}
+
+
+//
+// IsWriteQuery
+//
+// True if the query changes the table (insert or delete), false if it
+// only reads it.
+//
+bool IsWriteQuery(string query)
+{
+	vector<string> tokens = tokenize(query);
+	
+	return !tokens.empty() && (tokens.front() == "insert" || tokens.front() == "delete");
+}
+
+
+//
+// ExecuteQuery
+//
+// Parses and runs one query against the open table, writing its results
+// (or the reason it was ignored) to output.
+//
+void ExecuteQuery(database& db, string query, ostream& output)
+{
+	scopedtimer timer(TIME_QUERY);
+	
+	// call tokenize to push query into a vector
+	vector<string> tokens = tokenize(query);
+	
+	// check the first query word for the kind of query
+	if (!tokens.empty() && tokens.front() == "select")
+		_select(db, tokens, output);
+	else if (!tokens.empty() && tokens.front() == "delete")
+		_delete(db, tokens, output);
+	else if (!tokens.empty() && tokens.front() == "insert")
+		_insert(db, tokens, output);
+	else if (tokens.size() == 2 && tokens[0] == "show" && tokens[1] == "cache")
+		_showcache(db, output);
+	else if (tokens.size() == 2 && tokens[0] == "show" && tokens[1] == "pool")
+		_showpool(db, output);
+	else if (!tokens.empty() && tokens.front() == "stats")
+		_stats(tokens, output);
+	else
+		output << "Unknown query, ignored...\n";
+}
+
+
+//
+// _runselects
+//
+// Runs queries [first, last) of a batch, which are all selects, filling in
+// their results.  Queries on an indexed column are grouped by column and
+// probed in sorted value order; every query on a non-indexed column is
+// answered by one shared scan of the table.
+//
+static void _runselects(database& db, const vector<string>& queries, size_t first, size_t last,
+						vector<string>& results)
+{
+	vector<SELECTQUERY> selects;
+	vector<size_t> selectids;
+	
+	// parse each query, invalid ones get their error message as result
+	for (size_t i = first; i < last; i++)
+	{
+		ostringstream output;
+		vector<string> tokens = tokenize(queries[i]);
+		SELECTQUERY select;
+		
+		if (!tokens.empty() && tokens.front() == "select")
+		{
+			if (_parseselect(db, tokens, select, output))
+			{
+				// repeated queries are answered from the cache
+				if (db.Cache.lookup(_cachekey(db, select), db.Version, results[i]))
+					continue;
+				
+				// aggregates and spatial selects run on their own
+				if (select.Aggregate || select.Spatial != SPATIAL_NONE)
+				{
+					if (select.Aggregate)
+						_aggregate(db, select, output);
+					else
+						_spatialselect(db, db.Spatial, db.Table, select, output);
+					
+					results[i] = output.str();
+					db.Cache.insert(_cachekey(db, select), db.Version, results[i]);
+					continue;
+				}
+				
+				selects.push_back(select);
+				selectids.push_back(i);
+				continue;
+			}
+		}
+		else
+			output << "Unknown query, ignored...\n";
+		
+		results[i] = output.str();
+	}
+	
+	vector<vector<streamoff>> matches(selects.size());
+	
+	// indexed lookups (and column file scans), by column and then value,
+	// so probes that share a path down the tree run back to back
+	vector<size_t> indexed;
+	vector<size_t> scanned;
+	
+	for (size_t i = 0; i < selects.size(); i++)
+	{
+		// a column with a column file is scanned on its own, reading just
+		// that column beats sharing a pass over whole records
+		int index = _indexnumber(db, selects[i].WhereColumn);
+		
+		if ((index >= 0 && db.Trees[index].answers(selects[i].Pred)) ||
+			_columnfile(db, _columnnumber(db, selects[i].WhereColumn)) != nullptr)
+			indexed.push_back(i);
+		else
+			scanned.push_back(i);
+	}
+	
+	sort(indexed.begin(), indexed.end(), [&selects](size_t a, size_t b)
+	{
+		const predicate& preda = selects[a].Pred;
+		const predicate& predb = selects[b].Pred;
+		
+		if (selects[a].WhereColumn != selects[b].WhereColumn)
+			return selects[a].WhereColumn < selects[b].WhereColumn;
+		else if (preda.Type == TYPE_DOUBLE)
+			return preda.Real < predb.Real;
+		else if (preda.Type != TYPE_STRING)
+			return preda.Integer < predb.Integer;
+		else
+			return preda.Value < predb.Value;
+	});
+	
+	for (size_t i = 0; i < indexed.size(); i++)
+	{
+		SELECTQUERY& select = selects[indexed[i]];
+		matches[indexed[i]] = _findmatches(db, select.WhereColumn, select.Pred);
+	}
+	
+	// every non-indexed predicate in a single pass over the table
+	if (!scanned.empty())
+	{
+		vector<int> columns;
+		vector<predicate> preds;
+		
+		for (size_t i = 0; i < scanned.size(); i++)
+		{
+			SELECTQUERY& select = selects[scanned[i]];
+			
+			columns.push_back(find(db.ColumnNames.begin(), db.ColumnNames.end(), select.WhereColumn) - db.ColumnNames.begin());
+			preds.push_back(select.Pred);
+		}
+		
+		vector<vector<streamoff>> scanmatches = SharedScan(db.Table, columns, preds, db.NumThreads);
+		
+		for (size_t i = 0; i < scanned.size(); i++)
+			matches[scanned[i]].swap(scanmatches[i]);
+	}
+	
+	// format each query's matches as its result
+	for (size_t i = 0; i < selects.size(); i++)
+	{
+		ostringstream output;
+		
+		_printmatches(db, db.Table, selects[i].Column, matches[i], output);
+		results[selectids[i]] = output.str();
+		
+		db.Cache.insert(_cachekey(db, selects[i]), db.Version, results[selectids[i]]);
+	}
+}
+
+
+//
+// ExecuteBatch
+//
+// Runs a batch of queries and outputs each one's results in input order,
+// followed by the total time taken.  Runs of select queries are answered
+// together, see _runselects; every other query (insert, delete, show)
+// runs on its own, in order, so later selects see its changes.
+//
+void ExecuteBatch(database& db, const vector<string>& queries, ostream& output)
+{
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	vector<string> results(queries.size());
+	size_t first = 0;
+	
+	while (first < queries.size())
+	{
+		// find the run of selects up to the next other query
+		size_t last = first;
+		while (last < queries.size())
+		{
+			vector<string> tokens = tokenize(queries[last]);
+			
+			if (tokens.empty() || tokens.front() != "select")
+				break;
+			
+			last++;
+		}
+		
+		_runselects(db, queries, first, last, results);
+		
+		// then that query on its own
+		if (last < queries.size())
+		{
+			ostringstream otheroutput;
+			
+			ExecuteQuery(db, queries[last], otheroutput);
+			results[last] = otheroutput.str();
+			last++;
+		}
+		
+		first = last;
+	}
+	
+	chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+	
+	for (size_t i = 0; i < queries.size(); i++)
+		output << "Query> " << queries[i] << endl << results[i] << endl;
+	
+	output << "Ran " << queries.size() << " queries in "
+		   << chrono::duration<double, milli>(stop - start).count() << " ms" << endl;
+}
+
+
+//
+// TakeSnapshot
+//
+// Returns a new read-only snapshot of the database as it is now: a fresh
+// mapping of the data file plus a frozen copy of every index tree and
+// a copy of the spatial index.  Freezing a tree is O(n), so given the
+// previous snapshot only the trees written to since it was taken are
+// frozen again; the rest (and the spatial index, if unchanged) are
+// shared with it.
+//
+dbsnapshot* TakeSnapshot(database& db, const dbsnapshot* previous)
+{
+	dbsnapshot* snapshot = new dbsnapshot();
+	
+	snapshot->Table.open(db.TableName, db.RecordSize, db.NumColumns);
+	
+	for (size_t i = 0; i < db.Trees.size(); i++)
+	{
+		if (previous != nullptr && previous->IndexVersions[i] == db.IndexVersions[i])
+			snapshot->Indexes.push_back(previous->Indexes[i]);
+		else
+			snapshot->Indexes.push_back(make_shared<frozenindex>(db.Trees[i].freeze()));
+	}
+	
+	snapshot->IndexVersions = db.IndexVersions;
+	
+	if (previous != nullptr && previous->SpatialVersion == db.SpatialVersion)
+		snapshot->Spatial = previous->Spatial;
+	else
+		snapshot->Spatial = make_shared<spatialindex>(db.Spatial);
+	
+	snapshot->SpatialVersion = db.SpatialVersion;
+	
+	return snapshot;
+}
+
+
+//
+// ExecuteRead
+//
+// Runs a select query against a snapshot instead of the database itself,
+// writing its results to output.  Nothing shared is modified, so any
+// number of threads can run reads at once.  Non-indexed columns are
+// scanned on the calling thread only.  Aggregates work as in
+// ExecuteQuery, except count reads the matches to leave out records
+// deleted since the snapshot was taken.
+//
+void ExecuteRead(const database& db, dbsnapshot& snapshot, string query, ostream& output)
+{
+	vector<string> tokens = tokenize(query);
+	SELECTQUERY select;
+	
+	if (tokens.empty() || tokens.front() != "select")
+	{
+		output << "Unknown query, ignored...\n";
+		return;
+	}
+	
+	if (!_parseselect(db, tokens, select, output))
+		return;
+	
+	int aggregatecolumn = (select.AggregateColumn == "*") ? 0 : _columnnumber(db, select.AggregateColumn);
+	aggregate result(select.Function, db.ColumnTypes[aggregatecolumn]);
+	
+	// a spatial clause searches the snapshot's copy of the spatial index
+	if (select.Spatial != SPATIAL_NONE && select.Aggregate)
+	{
+		AggregatePositions(snapshot.Table, _spatialmatches(*snapshot.Spatial, snapshot.Table, select, nullptr),
+						   aggregatecolumn, result);
+		result.print(select.Column, output);
+		return;
+	}
+	else if (select.Spatial != SPATIAL_NONE)
+	{
+		_spatialselect(db, *snapshot.Spatial, snapshot.Table, select, output);
+		return;
+	}
+	
+	// an aggregate of every record, from the ends of the snapshot's index
+	// for min/max of an indexed column, otherwise a scan on this thread
+	if (select.Aggregate && !select.Where)
+	{
+		int index = _indexnumber(db, select.AggregateColumn);
+		bool done = false;
+		
+		if ((select.Function == AGG_MIN || select.Function == AGG_MAX) && index >= 0)
+			done = _indexextreme(*snapshot.Indexes[index], snapshot.Table, aggregatecolumn, result);
+		
+		if (!done)
+			result = ScanAggregate(snapshot.Table, aggregatecolumn, result, 1);
+		
+		result.print(select.Column, output);
+		return;
+	}
+	
+	vector<string>::const_iterator finditerator;
+	int index;
+	vector<streamoff> posvect;
+	
+	index = _indexnumber(db, select.WhereColumn);
+	
+	if (index >= 0 && snapshot.Indexes[index]->answers(select.Pred))
+	{
+		posvect = snapshot.Indexes[index]->search(select.Pred);
+		
+		// records deleted since the snapshot was taken are tombstones by now
+		vector<streamoff> live;
+		for (size_t i = 0; i < posvect.size(); i++)
+		{
+			if (!snapshot.Table.deleted(posvect[i]))
+				live.push_back(posvect[i]);
+		}
+		
+		posvect.swap(live);
+	}
+	else
+	{
+		finditerator = find(db.ColumnNames.begin(), db.ColumnNames.end(), select.WhereColumn);
+		index = distance(db.ColumnNames.begin(), finditerator);
+		
+		posvect = LinearSearch(snapshot.Table, select.Pred, index);
+	}
+	
+	// aggregates of the matches read them from the snapshot's table, so
+	// deleted records are already left out
+	if (select.Aggregate)
+	{
+		AggregatePositions(snapshot.Table, posvect, aggregatecolumn, result);
+		result.print(select.Column, output);
+	}
+	else
+		_printmatches(db, snapshot.Table, select.Column, posvect, output);
+}
+
+
+//
+// SaveIndexes
+//
+// Rewrites the index file of every index tree from the tree itself, so
+// the next startup doesn't have to rebuild trees changed by queries, and
+// restamps the column files, which queries kept in sync as they went.
+//
+void SaveIndexes(database& db)
+{
+	for (size_t i = 0; i < db.Trees.size(); i++)
+	{
+		db.Trees[i].save(db.TableName, db.IndexNames[i], db.IndexColumns[i]);
+	}
+	
+	for (size_t i = 0; i < db.Columns.size(); i++)
+	{
+		if (db.Columns[i].good())
+			db.Columns[i].restamp(db.TableName);
+	}
+	
+	db.IndexesChanged = false;
+}
@@ -0,0 +1,91 @@
+/*query.h*/
+
+// Query execution for myDB project
+
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <memory>
+
+#include "aggregate.h"
+#include "cache.h"
+#include "columnfile.h"
+#include "index.h"
+#include "postings.h"
+#include "table.h"
+#include "scan.h"
+#include "spatial.h"
+#include "stats.h"
+#include "types.h"
+
+using namespace std;
+
+//
+// database
+//
+// Everything known about the open table: its meta-data, its index trees
+// (one per indexed column), its mapped data file and any column files.
+//
+struct database
+{
+	string TableName;
+	int RecordSize;
+	int NumColumns;
+	vector<string> ColumnNames;  // every column, in record order
+	vector<columntype> ColumnTypes; // type of every column, in record order
+	vector<int> IndexColumns;    // column # of each indexed column
+	vector<string> IndexNames;   // column name of each indexed column
+	vector<columnindex> Trees;   // index tree of each indexed column
+	vector<frozenindex> Frozen;  // read-only snapshot of each tree
+	vector<int> StaleReads;      // reads since the tree changed, -1 if snapshot is current
+	vector<uint64_t> IndexVersions; // writes to each tree so far
+	bool IndexesChanged;         // saved index (or column) files are out of date
+	datatable Table;
+	vector<columnfile> Columns;  // column file of each column (--columnar), else empty
+	int LatitudeColumn;          // columns of the spatial index, -1 if there is none
+	int LongitudeColumn;
+	spatialindex Spatial;        // (latitude, longitude) of every record
+	uint64_t SpatialVersion;     // writes to the spatial index so far
+	int NumThreads;              // threads for scans of non-indexed columns
+	uint64_t Version;            // bumped by every write to the table
+	resultcache Cache;           // results of recent selects
+};
+
+//
+// dbsnapshot
+//
+// A read-only version of the database for concurrent readers: its own
+// mapping of the data file (records appended later are not in it), a
+// frozen copy of each index tree, in the same order as database::Trees,
+// and a copy of the spatial index.  The copies are shared with the
+// snapshots before and after it for as long as their tree (or the
+// spatial index) doesn't change, see TakeSnapshot.
+//
+struct dbsnapshot
+{
+	datatable Table;
+	vector<shared_ptr<frozenindex>> Indexes;
+	vector<uint64_t> IndexVersions; // database::IndexVersions each was frozen at
+	shared_ptr<const spatialindex> Spatial;
+	uint64_t SpatialVersion;
+};
+
+vector<string> tokenize(string line);
+
+void FreezeIndexes(database& db);
+
+void BuildSpatialIndex(database& db);
+
+bool IsWriteQuery(string query);
+
+void ExecuteQuery(database& db, string query, ostream& output);
+
+void ExecuteBatch(database& db, const vector<string>& queries, ostream& output);
+
+dbsnapshot* TakeSnapshot(database& db, const dbsnapshot* previous = nullptr);
+
+void ExecuteRead(const database& db, dbsnapshot& snapshot, string query, ostream& output);
+
+void SaveIndexes(database& db);
@@ -0,0 +1,108 @@
+/*rcu.h*/
+
+// Read-copy-update pointer with epoch based reclamation for myDB project
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <thread>
+
+#include "frozen.h" //for cachealigned
+
+using namespace std;
+
+//
+// rcupointer
+//
+// Holds the current version of some read-only state for many reader
+// threads and one writer at a time.  Readers never lock or write shared
+// memory other than their own slot:
+//
+//   T* p = ptr.enter(reader);   ...read *p...   ptr.exit(reader);
+//
+// A writer builds the next version on the side and publishes it; the old
+// version is deleted once every reader that could still see it has
+// exited (a grace period).  Each reader thread uses its own reader # in
+// [0, numReaders), and publish() calls must be serialized by the caller.
+//
+template<typename T>
+class rcupointer
+{
+private:
+	// one reader's epoch, 0 when outside a read; a cache line each so
+	// readers don't share lines with each other
+	struct alignas(64) SLOT
+	{
+		atomic<uint64_t> Active;
+		
+		SLOT() : Active(0) {}
+	};
+
+	atomic<T*> Current;
+	atomic<uint64_t> Epoch;
+	vector<SLOT, cachealigned<SLOT>> Slots;
+	int NumReaders;
+
+	// no copies, readers hold pointers into the current version
+	rcupointer(const rcupointer& other);
+	rcupointer& operator=(const rcupointer& other);
+
+public:
+	rcupointer(int numReaders, T* initial)
+		: Current(initial), Epoch(1), Slots(numReaders), NumReaders(numReaders)
+	{
+	}
+
+	~rcupointer()
+	{
+		delete Current.load();
+	}
+
+	// enter function (start a read, the version returned stays valid until exit)
+	T* enter(int reader)
+	{
+		// the slot has to be visible before the pointer is loaded, so a
+		// writer that swaps the pointer afterwards waits for this reader
+		Slots[reader].Active.store(Epoch.load());
+		return Current.load();
+	}
+
+	// current function (the current version, for the writer building the
+	// next one from it; only publish() replaces it)
+	T* current() const
+	{
+		return Current.load();
+	}
+
+	// exit function (end a read)
+	void exit(int reader)
+	{
+		Slots[reader].Active.store(0, memory_order_release);
+	}
+
+	// publish function (make next the current version, then wait out the
+	// readers of the old version and delete it)
+	void publish(T* next)
+	{
+		T* old = Current.exchange(next);
+		uint64_t epoch = Epoch.fetch_add(1) + 1;
+
+		// a reader active in an earlier epoch may still hold old
+		for (int i = 0; i < NumReaders; i++)
+		{
+			while (true)
+			{
+				uint64_t active = Slots[i].Active.load();
+
+				if (active == 0 || active >= epoch)
+					break;
+
+				this_thread::yield();
+			}
+		}
+
+		delete old;
+	}
+};
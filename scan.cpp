@@ -0,0 +1,472 @@
+/*scan.cpp*/
+
+// Vectorized full-table scans for myDB project
+//
+// Built with AVX2 when the compiler targets it (-mavx2 / -march=native),
+// otherwise SSE2 (always there on x86-64), otherwise plain scalar code.
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include <unordered_map>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "scan.h"
+#include "parallel.h"
+#include "stats.h"
+
+using namespace std;
+
+
+#if defined(__AVX2__)
+static const size_t BLOCK = 32;
+#elif defined(__SSE2__)
+static const size_t BLOCK = 16;
+#else
+static const size_t BLOCK = 8;
+#endif
+
+
+//
+// _whitespacemask
+//
+// Returns a bitmask with bit i set if p[i] is a space, tab, \r or \n,
+// for the BLOCK bytes starting at p.  p must have BLOCK readable bytes.
+//
+static uint32_t _whitespacemask(const char* p)
+{
+#if defined(__AVX2__)
+	__m256i block = _mm256_loadu_si256((const __m256i*) p);
+	__m256i ws = _mm256_or_si256(
+		_mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8(' ')),
+						_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\t'))),
+		_mm256_or_si256(_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\r')),
+						_mm256_cmpeq_epi8(block, _mm256_set1_epi8('\n'))));
+	return (uint32_t) _mm256_movemask_epi8(ws);
+#elif defined(__SSE2__)
+	__m128i block = _mm_loadu_si128((const __m128i*) p);
+	__m128i ws = _mm_or_si128(
+		_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8(' ')),
+					 _mm_cmpeq_epi8(block, _mm_set1_epi8('\t'))),
+		_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\r')),
+					 _mm_cmpeq_epi8(block, _mm_set1_epi8('\n'))));
+	return (uint32_t) _mm_movemask_epi8(ws);
+#else
+	uint32_t mask = 0;
+	for (size_t i = 0; i < BLOCK; i++)
+	{
+		char c = p[i];
+		if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+			mask |= (uint32_t) 1 << i;
+	}
+	return mask;
+#endif
+}
+
+
+//
+// _blockmask
+//
+// _whitespacemask for the block at offset off of a record, treating the
+// bytes past the end of the record as whitespace.  The last partial block
+// is copied out first so we never load past the record (or the mapping).
+//
+static uint32_t _blockmask(const char* record, size_t recordSize, size_t off)
+{
+	if (off + BLOCK <= recordSize)
+		return _whitespacemask(record + off);
+	
+	char tail[BLOCK];
+	memset(tail, ' ', BLOCK);
+	memcpy(tail, record + off, recordSize - off);
+	
+	return _whitespacemask(tail);
+}
+
+
+//
+// FindColumn
+//
+// Finds the given column (0-based) of a whitespace-separated record,
+// BLOCK bytes at a time: a value starts wherever a non-whitespace byte
+// follows a whitespace byte, so the starts of every value in a block
+// fall out of one whitespace mask.  Returns a 0-length view if the
+// record has fewer values.
+//
+fieldview FindColumn(const char* record, size_t recordSize, int column)
+{
+	fieldview field;
+	field.Data = record + recordSize;
+	field.Length = 0;
+	
+	uint32_t prevws = 1; // the start of the record counts as whitespace
+	size_t off;
+	uint32_t starts = 0;
+	
+	// find the block holding the start of the value...
+	for (off = 0; off < recordSize; off += BLOCK)
+	{
+		uint32_t ws = _blockmask(record, recordSize, off);
+		starts = ~ws & ((ws << 1) | prevws);
+		if (BLOCK < 32)
+			starts &= (uint32_t) (((uint64_t) 1 << BLOCK) - 1);
+		
+		int count = __builtin_popcount(starts);
+		if (column < count)
+			break;
+		
+		column -= count;
+		prevws = (ws >> (BLOCK - 1)) & 1;
+	}
+	
+	if (off >= recordSize)
+		return field;
+	
+	// drop the starts before ours, the lowest remaining bit is the value
+	for (int i = 0; i < column; i++)
+		starts &= starts - 1;
+	
+	size_t start = off + __builtin_ctz(starts);
+	
+	// find the whitespace ending the value, again a block at a time...
+	size_t end = recordSize;
+	for (off = start; off < recordSize; off += BLOCK)
+	{
+		uint32_t ws = _blockmask(record, recordSize, off);
+		if (ws != 0)
+		{
+			end = min(recordSize, off + __builtin_ctz(ws));
+			break;
+		}
+	}
+	
+	field.Data = record + start;
+	field.Length = end - start;
+	
+	return field;
+}
+
+
+//
+// ValuesEqual
+//
+// Compares length bytes of a and b, BLOCK bytes at a time.
+//
+bool ValuesEqual(const char* a, const char* b, size_t length)
+{
+	size_t i = 0;
+	
+#if defined(__AVX2__)
+	for (; i + 32 <= length; i += 32)
+	{
+		__m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) (a + i)),
+									   _mm256_loadu_si256((const __m256i*) (b + i)));
+		if ((uint32_t) _mm256_movemask_epi8(eq) != 0xFFFFFFFFu)
+			return false;
+	}
+#endif
+#if defined(__AVX2__) || defined(__SSE2__)
+	for (; i + 16 <= length; i += 16)
+	{
+		__m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) (a + i)),
+									_mm_loadu_si128((const __m128i*) (b + i)));
+		if (_mm_movemask_epi8(eq) != 0xFFFF)
+			return false;
+	}
+#endif
+	
+	return memcmp(a + i, b + i, length - i) == 0;
+}
+
+
+//
+// _comparevalues
+//
+// Compares a and b the way string::compare does: <0, 0 or >0.
+//
+static int _comparevalues(const char* a, size_t alength, const char* b, size_t blength)
+{
+	int result = memcmp(a, b, min(alength, blength));
+	
+	if (result != 0)
+		return result;
+	else if (alength == blength)
+		return 0;
+	else
+		return (alength < blength) ? -1 : 1;
+}
+
+
+//
+// predicate::settype
+//
+// Makes the predicate compare as the given column type, parsing Value
+// (and Value2) once up front.  Returns false if a value isn't valid for
+// the type, or the comparison is a like on a column that isn't strings.
+//
+bool predicate::settype(columntype type)
+{
+	Type = type;
+	
+	if (type == TYPE_STRING)
+		return true;
+	
+	if (Op == OP_PREFIX)
+		return false;
+	
+	if (type == TYPE_DOUBLE)
+		return ParseValue(Value.data(), Value.size(), type, Real) &&
+			   (Op != OP_BETWEEN || ParseValue(Value2.data(), Value2.size(), type, Real2));
+	else
+		return ParseValue(Value.data(), Value.size(), type, Integer) &&
+			   (Op != OP_BETWEEN || ParseValue(Value2.data(), Value2.size(), type, Integer2));
+}
+
+
+//
+// _comparekeys
+//
+// Checks a parsed column value against a comparison and its parsed
+// bound(s).  Prefix matches only apply to strings, so never match here.
+//
+template<typename TKey>
+static bool _comparekeys(compareop op, TKey value, TKey low, TKey high)
+{
+	switch (op)
+	{
+		case OP_EQUAL:
+			return value == low;
+		case OP_LESS:
+			return value < low;
+		case OP_LESSEQUAL:
+			return value <= low;
+		case OP_GREATER:
+			return value > low;
+		case OP_GREATEREQUAL:
+			return value >= low;
+		case OP_BETWEEN:
+			return value >= low && value <= high;
+		case OP_PREFIX:
+			return false;
+	}
+	
+	return false;
+}
+
+
+//
+// predicate::matches
+//
+// Checks a column value against the predicate.  Values of a typed
+// column are parsed first; one that isn't valid for the type never
+// matches.
+//
+bool predicate::matches(int64_t value) const
+{
+	return _comparekeys(Op, value, Integer, Integer2);
+}
+
+bool predicate::matches(double value) const
+{
+	return _comparekeys(Op, value, Real, Real2);
+}
+
+bool predicate::matches(const char* data, size_t length) const
+{
+	if (Type == TYPE_DOUBLE)
+	{
+		double value;
+		return ParseValue(data, length, Type, value) && matches(value);
+	}
+	else if (Type != TYPE_STRING)
+	{
+		int64_t value;
+		return ParseValue(data, length, Type, value) && matches(value);
+	}
+	
+	switch (Op)
+	{
+		case OP_EQUAL:
+			// lengths differ on most records, so check that before the bytes
+			return length == Value.size() && ValuesEqual(data, Value.data(), length);
+		case OP_LESS:
+			return _comparevalues(data, length, Value.data(), Value.size()) < 0;
+		case OP_LESSEQUAL:
+			return _comparevalues(data, length, Value.data(), Value.size()) <= 0;
+		case OP_GREATER:
+			return _comparevalues(data, length, Value.data(), Value.size()) > 0;
+		case OP_GREATEREQUAL:
+			return _comparevalues(data, length, Value.data(), Value.size()) >= 0;
+		case OP_BETWEEN:
+			return _comparevalues(data, length, Value.data(), Value.size()) >= 0 &&
+				   _comparevalues(data, length, Value2.data(), Value2.size()) <= 0;
+		case OP_PREFIX:
+			return length >= Value.size() && ValuesEqual(data, Value.data(), Value.size());
+	}
+	
+	return false;
+}
+
+
+//
+// ScanColumn
+//
+// Scans records [firstRecord, lastRecord) of an open table in one pass
+// over the mapping (or the pool, a page at a time), and returns the file positions of the records whose
+// given column (0-based) matches the predicate, in file order.  Deleted
+// records never match.
+//
+// Example: ScanColumn(table, {OP_EQUAL, "kim"}, 2, 0, table.numrecords())
+// returns 164 and 410 for "students.data".
+//
+vector<streamoff> ScanColumn(const datatable& table, const predicate& pred, int matchColumn, streamoff firstRecord, streamoff lastRecord)
+{
+	vector<streamoff> matches;
+	
+	size_t recordsize = table.recordsize();
+	recordpin pin;
+	
+	for (streamoff rec = firstRecord; rec < lastRecord; rec++)
+	{
+		streamoff pos = rec * recordsize;
+		const char* record = pin.at(table, pos);
+		
+		// skip deleted records
+		if (record[0] == '.')
+			continue;
+		
+		fieldview field = FindColumn(record, recordsize, matchColumn);
+		
+		if (pred.matches(field.Data, field.Length))
+			matches.push_back(pos);
+	}
+	
+	return matches;
+}
+
+
+//
+// ParallelScanColumn
+//
+// Same as ScanColumn over the whole table, but splits the records into
+// numThreads contiguous ranges and scans each range on its own thread.
+// Each thread collects its own matches, and the ranges are merged back
+// in order, so the result is in file order just like ScanColumn.  Small
+// tables are scanned on the calling thread.
+//
+vector<streamoff> ParallelScanColumn(const datatable& table, const predicate& pred, int matchColumn, int numThreads)
+{
+	return SplitRecords(table.numrecords(), numThreads, vector<streamoff>(),
+		[&table, &pred, matchColumn](streamoff first, streamoff last)
+		{
+			return ScanColumn(table, pred, matchColumn, first, last);
+		},
+		AppendRange);
+}
+
+
+//
+// _sharedscanrange
+//
+// SharedScan over records [firstRecord, lastRecord), see below.
+//
+static vector<vector<streamoff>> _sharedscanrange(const datatable& table, const vector<int>& columns, const vector<predicate>& preds, streamoff firstRecord, streamoff lastRecord)
+{
+	vector<vector<streamoff>> matches(preds.size());
+	
+	// group the predicates by column, and keep each column's string
+	// equality predicates in a hash table by value so all of them cost
+	// one lookup
+	vector<int> scancolumns;
+	vector<unordered_map<string, vector<size_t>>> equalpreds;
+	vector<vector<size_t>> otherpreds;
+	
+	for (size_t i = 0; i < preds.size(); i++)
+	{
+		size_t c = find(scancolumns.begin(), scancolumns.end(), columns[i]) - scancolumns.begin();
+		
+		if (c == scancolumns.size())
+		{
+			scancolumns.push_back(columns[i]);
+			equalpreds.push_back(unordered_map<string, vector<size_t>>());
+			otherpreds.push_back(vector<size_t>());
+		}
+		
+		// (typed values can be equal with different text, "7" and "07")
+		if (preds[i].Op == OP_EQUAL && preds[i].Type == TYPE_STRING)
+			equalpreds[c][preds[i].Value].push_back(i);
+		else
+			otherpreds[c].push_back(i);
+	}
+	
+	size_t recordsize = table.recordsize();
+	string value;
+	recordpin pin;
+	
+	for (streamoff rec = firstRecord; rec < lastRecord; rec++)
+	{
+		streamoff pos = rec * recordsize;
+		const char* record = pin.at(table, pos);
+		
+		// skip deleted records
+		if (record[0] == '.')
+			continue;
+		
+		for (size_t c = 0; c < scancolumns.size(); c++)
+		{
+			fieldview field = FindColumn(record, recordsize, scancolumns[c]);
+			
+			if (!equalpreds[c].empty())
+			{
+				value.assign(field.Data, field.Length);
+				
+				unordered_map<string, vector<size_t>>::const_iterator found = equalpreds[c].find(value);
+				if (found != equalpreds[c].end())
+				{
+					for (size_t i = 0; i < found->second.size(); i++)
+						matches[found->second[i]].push_back(pos);
+				}
+			}
+			
+			for (size_t i = 0; i < otherpreds[c].size(); i++)
+			{
+				if (preds[otherpreds[c][i]].matches(field.Data, field.Length))
+					matches[otherpreds[c][i]].push_back(pos);
+			}
+		}
+	}
+	
+	return matches;
+}
+
+
+//
+// SharedScan
+//
+// Answers many predicates with one pass over the table: predicate i is
+// matched against column columns[i] (0-based), and the result holds the
+// positions of the records matching each predicate, in file order.  The
+// records are split across numThreads threads like ParallelScanColumn.
+//
+vector<vector<streamoff>> SharedScan(const datatable& table, const vector<int>& columns, const vector<predicate>& preds, int numThreads)
+{
+	StatCount(COUNT_BYTESREAD, table.numrecords() * table.recordsize());
+	
+	// each predicate's matches are merged in file order
+	return SplitRecords(table.numrecords(), numThreads, vector<vector<streamoff>>(preds.size()),
+		[&table, &columns, &preds](streamoff first, streamoff last)
+		{
+			return _sharedscanrange(table, columns, preds, first, last);
+		},
+		[](vector<vector<streamoff>>& matches, const vector<vector<streamoff>>& part)
+		{
+			for (size_t p = 0; p < matches.size(); p++)
+				AppendRange(matches[p], part[p]);
+		});
+}
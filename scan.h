@@ -0,0 +1,94 @@
+/*scan.h*/
+
+// Vectorized full-table scans for myDB project
+
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+
+#include "table.h"
+#include "types.h"
+
+using namespace std;
+
+// comparison in a where clause
+enum compareop
+{
+	OP_EQUAL,        // col = v
+	OP_LESS,         // col < v
+	OP_LESSEQUAL,    // col <= v
+	OP_GREATER,      // col > v
+	OP_GREATEREQUAL, // col >= v
+	OP_BETWEEN,      // col between v and v2 (inclusive)
+	OP_PREFIX        // col like v%
+};
+
+//
+// predicate
+//
+// One where clause comparison against a column value.  Values compare
+// as the column's type, the same order its index tree uses: strings
+// byte by byte, ints, doubles and dates as numbers (see settype).
+//
+struct predicate
+{
+	compareop Op;
+	string Value;
+	string Value2;    // upper bound for OP_BETWEEN
+	columntype Type;  // how values compare, TYPE_STRING unless settype is called
+	int64_t Integer;  // Value and Value2 parsed, for int and date columns
+	int64_t Integer2;
+	double Real;      // Value and Value2 parsed, for double columns
+	double Real2;
+	
+	predicate()
+		: Op(OP_EQUAL), Type(TYPE_STRING), Integer(0), Integer2(0), Real(0), Real2(0)
+	{
+	}
+	
+	bool settype(columntype type);
+	
+	bool matches(const char* data, size_t length) const;
+	bool matches(int64_t value) const;
+	bool matches(double value) const;
+	
+	// matches function (check a string value)
+	bool matches(const string& value) const
+	{
+		return matches(value.data(), value.size());
+	}
+	
+	// key function (Value as the key type of the column's index tree)
+	template<typename TKey>
+	const TKey& key() const;
+};
+
+template<>
+inline const string& predicate::key<string>() const
+{
+	return Value;
+}
+
+template<>
+inline const int64_t& predicate::key<int64_t>() const
+{
+	return Integer;
+}
+
+template<>
+inline const double& predicate::key<double>() const
+{
+	return Real;
+}
+
+fieldview FindColumn(const char* record, size_t recordSize, int column);
+
+bool ValuesEqual(const char* a, const char* b, size_t length);
+
+vector<streamoff> ScanColumn(const datatable& table, const predicate& pred, int matchColumn, streamoff firstRecord, streamoff lastRecord);
+
+vector<streamoff> ParallelScanColumn(const datatable& table, const predicate& pred, int matchColumn, int numThreads);
+
+vector<vector<streamoff>> SharedScan(const datatable& table, const vector<int>& columns, const vector<predicate>& preds, int numThreads);
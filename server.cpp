@@ -0,0 +1,549 @@
+/*server.cpp*/
+
+// Multi-reader query server for myDB project
+//
+// Clients connect to a Unix domain socket and send one query per line,
+// in the same grammar as the interactive prompt.  Each response is the
+// query's output followed by a blank line.  "exit" closes the client's
+// connection and "shutdown" stops the server.
+//
+// One thread polls the listening socket and every idle connection; a
+// connection with input is queued for a pool of worker threads, which
+// run one query each from it before it goes back to be polled.  So any
+// number of clients can stay connected without holding a worker, and a
+// worker is only ever busy running a query.  Selects run
+// against the current dbsnapshot through an rcupointer, so readers never
+// take a lock; inserts and deletes are serialized by a mutex, applied to
+// the database itself and then published as a new snapshot.  Writes that
+// arrive while a snapshot is being published go out together in the
+// next one.
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <atomic>
+#include <cstring>
+#include <cerrno>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "server.h"
+#include "rcu.h"
+
+using namespace std;
+
+
+//
+// CONNECTION
+//
+// One client connection, and what it has sent that hasn't been run yet.
+// At any time it is either watched by the polling thread, queued for a
+// worker or being served by one, never two of them at once, so its
+// responses go out in the order of its queries.
+//
+struct CONNECTION
+{
+	int Fd;
+	string Pending; // received input not yet run, up to a partial line
+};
+
+
+//
+// SERVER
+//
+// State shared by the polling thread and the workers.
+//
+struct SERVER
+{
+	database* Db;
+	rcupointer<dbsnapshot>* Snapshot;
+	mutex WriteLock;            // serializes writes to Db
+	uint64_t Written;           // writes applied to Db, under WriteLock
+	mutex PublishLock;          // serializes publishes of Snapshot
+	uint64_t Published;         // writes in the current snapshot, under PublishLock
+	
+	int ListenFd;
+	int WakeFds[2];             // pipe that wakes the polling thread
+	atomic<bool> Stopping;
+	mutex QueueLock;            // guards Ready and Idle
+	condition_variable QueueReady;
+	deque<CONNECTION*> Ready;   // connections with a query to run, for the workers
+	vector<CONNECTION*> Idle;   // connections handed back to the polling thread
+	
+	vector<vector<double>> Latencies; // microseconds per query, per worker
+};
+
+
+//
+// _sendall
+//
+// Writes all of data to the connection; false if the client went away.
+//
+static bool _sendall(int fd, const string& data)
+{
+	size_t sent = 0;
+	
+	while (sent < data.size())
+	{
+		ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+		
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		{
+			// the client isn't reading fast enough, wait for room
+			pollfd out = { fd, POLLOUT, 0 };
+			poll(&out, 1, -1);
+			continue;
+		}
+		
+		if (n <= 0)
+			return false;
+		
+		sent += n;
+	}
+	
+	return true;
+}
+
+
+//
+// _wake
+//
+// Wakes the polling thread, to pick up handed back connections or stop.
+//
+static void _wake(SERVER& server)
+{
+	char signal = 1;
+	
+	// a full pipe already has a wakeup pending
+	if (write(server.WakeFds[1], &signal, 1) < 0 && errno != EAGAIN)
+		cerr << "**Error: couldn't wake the polling thread: " << strerror(errno) << "." << endl;
+}
+
+
+//
+// _stop
+//
+// Stops the polling thread and every worker; queries being run finish
+// first, queued ones are dropped.
+//
+static void _stop(SERVER& server)
+{
+	server.Stopping = true;
+	_wake(server);
+	
+	lock_guard<mutex> guard(server.QueueLock);
+	server.QueueReady.notify_all();
+}
+
+
+//
+// _isselect
+//
+// True if the query is a select, which a snapshot can answer.
+//
+static bool _isselect(const string& query)
+{
+	vector<string> tokens = tokenize(query);
+	
+	return !tokens.empty() && tokens.front() == "select";
+}
+
+
+//
+// _runquery
+//
+// Runs one query from a client and returns its output.  Selects go to
+// the current snapshot; writes take the write lock, change the database
+// and return once a snapshot with the change in it is published.  The
+// rest ("stats", "show cache", "show pool") report on the database
+// itself, and run under the write lock so no write changes it meanwhile.
+//
+static string _runquery(SERVER& server, int worker, const string& query)
+{
+	ostringstream output;
+	
+	if (IsWriteQuery(query))
+	{
+		uint64_t written;
+		
+		{
+			lock_guard<mutex> guard(server.WriteLock);
+			
+			ExecuteQuery(*server.Db, query, output);
+			written = ++server.Written;
+		}
+		
+		// the writes made while another one was publishing all go out in
+		// one snapshot, taken by whichever of them gets here first
+		lock_guard<mutex> publishguard(server.PublishLock);
+		
+		if (server.Published < written)
+		{
+			dbsnapshot* next;
+			
+			{
+				lock_guard<mutex> guard(server.WriteLock);
+				
+				next = TakeSnapshot(*server.Db, server.Snapshot->current());
+				server.Published = server.Written;
+			}
+			
+			server.Snapshot->publish(next);
+		}
+	}
+	else if (_isselect(query))
+	{
+		dbsnapshot* snapshot = server.Snapshot->enter(worker);
+		
+		ExecuteRead(*server.Db, *snapshot, query, output);
+		
+		server.Snapshot->exit(worker);
+	}
+	else
+	{
+		lock_guard<mutex> guard(server.WriteLock);
+		
+		ExecuteQuery(*server.Db, query, output);
+	}
+	
+	return output.str();
+}
+
+
+//
+// _nextquery
+//
+// Takes the first complete line off the connection's pending input into
+// query; false if there is none yet.
+//
+static bool _nextquery(CONNECTION& connection, string& query)
+{
+	size_t newline = connection.Pending.find('\n');
+	
+	if (newline == string::npos)
+		return false;
+	
+	query = connection.Pending.substr(0, newline);
+	connection.Pending.erase(0, newline + 1);
+	
+	if (!query.empty() && query.back() == '\r')
+		query.pop_back();
+	
+	return true;
+}
+
+
+//
+// _hasquery
+//
+// True if the connection's pending input holds a complete line.
+//
+static bool _hasquery(const CONNECTION& connection)
+{
+	return connection.Pending.find('\n') != string::npos;
+}
+
+
+//
+// _serveone
+//
+// Serves one turn of a connection: reads what the client has sent if no
+// complete query is pending, then runs one query.  Returns false once
+// the client exits or disconnects.
+//
+static bool _serveone(SERVER& server, int worker, CONNECTION& connection)
+{
+	if (!_hasquery(connection))
+	{
+		char buffer[4096];
+		ssize_t n = recv(connection.Fd, buffer, sizeof(buffer), 0);
+		
+		if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+			return true;
+		
+		if (n <= 0)
+			return false;
+		
+		connection.Pending.append(buffer, n);
+	}
+	
+	string query;
+	
+	if (!_nextquery(connection, query))
+		return true;
+	
+	if (query == "exit")
+		return false;
+	
+	if (query == "shutdown")
+	{
+		_sendall(connection.Fd, "Shutting down...\n\n");
+		_stop(server);
+		return false;
+	}
+	
+	chrono::steady_clock::time_point begin = chrono::steady_clock::now();
+	string response = _runquery(server, worker, query);
+	chrono::steady_clock::time_point end = chrono::steady_clock::now();
+	
+	server.Latencies[worker].push_back(chrono::duration<double, micro>(end - begin).count());
+	
+	return _sendall(connection.Fd, response + "\n");
+}
+
+
+//
+// _worker
+//
+// Worker thread: runs one query at a time from whichever connection is
+// ready, until the server stops.  A connection with more queries already
+// received goes to the back of the queue, so one busy client can't hold
+// a worker; otherwise it goes back to the polling thread to wait for
+// input, so idle clients hold none.
+//
+static void _worker(SERVER& server, int worker)
+{
+	while (true)
+	{
+		CONNECTION* connection;
+		
+		{
+			unique_lock<mutex> guard(server.QueueLock);
+			
+			server.QueueReady.wait(guard, [&server]() { return server.Stopping || !server.Ready.empty(); });
+			
+			if (server.Stopping)
+				return;
+			
+			connection = server.Ready.front();
+			server.Ready.pop_front();
+		}
+		
+		if (!_serveone(server, worker, *connection))
+		{
+			close(connection->Fd);
+			delete connection;
+			continue;
+		}
+		
+		lock_guard<mutex> guard(server.QueueLock);
+		
+		if (_hasquery(*connection))
+		{
+			server.Ready.push_back(connection);
+			server.QueueReady.notify_one();
+		}
+		else
+		{
+			server.Idle.push_back(connection);
+			_wake(server);
+		}
+	}
+}
+
+
+//
+// _percentile
+//
+// Returns the p-th percentile (0..100) of the sorted samples.
+//
+static double _percentile(const vector<double>& sorted, double p)
+{
+	if (sorted.empty())
+		return 0;
+	
+	size_t i = (size_t) (p / 100.0 * (sorted.size() - 1) + 0.5);
+	
+	return sorted[i];
+}
+
+
+//
+// RunServer
+//
+// Serves queries on the Unix domain socket at socketpath with numThreads
+// worker threads until a client sends "shutdown", then outputs the
+// throughput and latency of the queries served.  Returns false if the
+// socket couldn't be set up.
+//
+bool RunServer(database& db, string socketpath, int numThreads, ostream& log)
+{
+	SERVER server;
+	
+	server.Db = &db;
+	server.Stopping = false;
+	server.Written = 0;
+	server.Published = 0;
+	server.Latencies.resize(numThreads);
+	
+	// set up the listening socket, replacing one left by an earlier run
+	sockaddr_un address;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	
+	if (socketpath.size() >= sizeof(address.sun_path))
+	{
+		log << "**Error: socket path '" << socketpath << "' is too long." << endl;
+		return false;
+	}
+	
+	strcpy(address.sun_path, socketpath.c_str());
+	unlink(socketpath.c_str());
+	
+	server.ListenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	
+	if (server.ListenFd < 0 ||
+		bind(server.ListenFd, (sockaddr*) &address, sizeof(address)) < 0 ||
+		listen(server.ListenFd, 128) < 0)
+	{
+		log << "**Error: couldn't listen on '" << socketpath << "': " << strerror(errno) << "." << endl;
+		
+		if (server.ListenFd >= 0)
+			close(server.ListenFd);
+		
+		return false;
+	}
+	
+	// neither end of the wakeup pipe, nor the listening socket, may block
+	// the polling thread
+	if (pipe(server.WakeFds) < 0)
+	{
+		log << "**Error: couldn't create the wakeup pipe: " << strerror(errno) << "." << endl;
+		close(server.ListenFd);
+		return false;
+	}
+	
+	fcntl(server.WakeFds[0], F_SETFL, O_NONBLOCK);
+	fcntl(server.WakeFds[1], F_SETFL, O_NONBLOCK);
+	fcntl(server.ListenFd, F_SETFL, fcntl(server.ListenFd, F_GETFL) | O_NONBLOCK);
+	
+	rcupointer<dbsnapshot> snapshot(numThreads, TakeSnapshot(db));
+	server.Snapshot = &snapshot;
+	
+	log << "Serving queries on " << socketpath << " with " << numThreads << " threads..." << endl;
+	
+	chrono::steady_clock::time_point start = chrono::steady_clock::now();
+	vector<thread> workers;
+	
+	for (int i = 0; i < numThreads; i++)
+		workers.push_back(thread(_worker, ref(server), i));
+	
+	// poll the listening socket and every idle connection, queueing the
+	// connections with input for the workers, until shutdown
+	vector<CONNECTION*> watched;
+	vector<pollfd> fds;
+	
+	while (!server.Stopping)
+	{
+		fds.clear();
+		fds.push_back({ server.ListenFd, POLLIN, 0 });
+		fds.push_back({ server.WakeFds[0], POLLIN, 0 });
+		
+		for (CONNECTION* connection : watched)
+			fds.push_back({ connection->Fd, POLLIN, 0 });
+		
+		if (poll(fds.data(), fds.size(), -1) < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			
+			log << "**Error: couldn't poll connections: " << strerror(errno) << "." << endl;
+			break;
+		}
+		
+		// connections with input (or hung up) stop being watched until a
+		// worker hands them back
+		vector<CONNECTION*> ready, waiting;
+		
+		for (size_t i = 0; i < watched.size(); i++)
+		{
+			if (fds[i + 2].revents != 0)
+				ready.push_back(watched[i]);
+			else
+				waiting.push_back(watched[i]);
+		}
+		
+		watched.swap(waiting);
+		
+		if (fds[0].revents != 0)
+		{
+			int fd = accept(server.ListenFd, nullptr, nullptr);
+			
+			if (fd >= 0)
+			{
+				fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+				watched.push_back(new CONNECTION{ fd, "" });
+			}
+		}
+		
+		if (fds[1].revents != 0)
+		{
+			char signals[64];
+			
+			while (read(server.WakeFds[0], signals, sizeof(signals)) > 0)
+				;
+		}
+		
+		lock_guard<mutex> guard(server.QueueLock);
+		
+		watched.insert(watched.end(), server.Idle.begin(), server.Idle.end());
+		server.Idle.clear();
+		
+		for (CONNECTION* connection : ready)
+		{
+			server.Ready.push_back(connection);
+			server.QueueReady.notify_one();
+		}
+	}
+	
+	_stop(server);
+	
+	for (size_t i = 0; i < workers.size(); i++)
+		workers[i].join();
+	
+	// every connection is back in one of these once the workers are done
+	watched.insert(watched.end(), server.Ready.begin(), server.Ready.end());
+	watched.insert(watched.end(), server.Idle.begin(), server.Idle.end());
+	
+	for (CONNECTION* connection : watched)
+	{
+		close(connection->Fd);
+		delete connection;
+	}
+	
+	close(server.WakeFds[0]);
+	close(server.WakeFds[1]);
+	close(server.ListenFd);
+	unlink(socketpath.c_str());
+	
+	chrono::steady_clock::time_point stop = chrono::steady_clock::now();
+	
+	// report throughput and latency over every query served
+	vector<double> latencies;
+	
+	for (size_t i = 0; i < server.Latencies.size(); i++)
+		latencies.insert(latencies.end(), server.Latencies[i].begin(), server.Latencies[i].end());
+	
+	sort(latencies.begin(), latencies.end());
+	
+	double seconds = chrono::duration<double>(stop - start).count();
+	
+	log << "Served " << latencies.size() << " queries in " << seconds << " s ("
+		<< (seconds > 0 ? latencies.size() / seconds : 0) << " queries/s)" << endl;
+	log << "\tLatency p50: " << _percentile(latencies, 50) << " us" << endl;
+	log << "\tLatency p99: " << _percentile(latencies, 99) << " us" << endl;
+	log << "\tLatency max: " << (latencies.empty() ? 0 : latencies.back()) << " us" << endl;
+	
+	return true;
+}
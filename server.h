@@ -0,0 +1,14 @@
+/*server.h*/
+
+// Multi-reader query server for myDB project
+
+#pragma once
+
+#include <iostream>
+#include <string>
+
+#include "query.h"
+
+using namespace std;
+
+bool RunServer(database& db, string socketpath, int numThreads, ostream& log);
@@ -0,0 +1,385 @@
+/*spatial.cpp*/
+
+// Spatial (latitude/longitude) index for myDB project
+
+#include <iostream>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+
+#include "spatial.h"
+#include "stats.h"
+
+using namespace std;
+
+
+//
+// GreatCircleKm
+//
+// Distance in km between two (latitude, longitude) points in degrees,
+// along the earth's surface (haversine formula).
+//
+double GreatCircleKm(double lat1, double lon1, double lat2, double lon2)
+{
+	const double earthradius = 6371.0088;
+	const double radians = M_PI / 180;
+	
+	double dlat = (lat2 - lat1) * radians;
+	double dlon = (lon2 - lon1) * radians;
+	double a = sin(dlat / 2) * sin(dlat / 2) +
+			   cos(lat1 * radians) * cos(lat2 * radians) * sin(dlon / 2) * sin(dlon / 2);
+	
+	return 2 * earthradius * asin(min(1.0, sqrt(a)));
+}
+
+
+//
+// spatialindex::_point
+//
+// The point of a record, longitude scaled onto the flat projection.
+//
+spatialindex::POINT spatialindex::_point(double lat, double lon, streamoff pos) const
+{
+	POINT point;
+	
+	point.X = lon * Scale;
+	point.Y = lat;
+	point.Pos = pos;
+	
+	return point;
+}
+
+
+//
+// spatialindex::_build
+//
+// Arranges Points[low, high) into a k-d tree: the median (on latitude
+// at even depths, longitude at odd ones) goes in the middle, smaller
+// points before it and larger after, and each half the same way.
+//
+void spatialindex::_build(size_t low, size_t high, int depth)
+{
+	if (high - low <= 1)
+		return;
+	
+	size_t mid = low + (high - low) / 2;
+	
+	if (depth % 2 == 0)
+		nth_element(Points.begin() + low, Points.begin() + mid, Points.begin() + high,
+					[](const POINT& a, const POINT& b) { return a.Y < b.Y; });
+	else
+		nth_element(Points.begin() + low, Points.begin() + mid, Points.begin() + high,
+					[](const POINT& a, const POINT& b) { return a.X < b.X; });
+	
+	_build(low, mid, depth + 1);
+	_build(mid + 1, high, depth + 1);
+}
+
+
+//
+// spatialindex::_rebuild
+//
+// Rebuilds the tree from its live points and the pending ones.
+//
+void spatialindex::_rebuild()
+{
+	vector<POINT> points;
+	points.reserve(size());
+	
+	for (const POINT& point : Points)
+	{
+		if (point.Pos >= 0)
+			points.push_back(point);
+	}
+	
+	points.insert(points.end(), Pending.begin(), Pending.end());
+	
+	Points.swap(points);
+	Pending.clear();
+	NumRemoved = 0;
+	
+	_build(0, Points.size(), 0);
+}
+
+
+//
+// spatialindex::build
+//
+// Builds the index from the latitude, longitude and position of every
+// record, O(n log n).
+//
+void spatialindex::build(const vector<double>& lats, const vector<double>& lons, const vector<streamoff>& positions)
+{
+	double total = 0;
+	
+	for (double lat : lats)
+		total += lat;
+	
+	// project around the mean latitude (not too near a pole)
+	Scale = lats.empty() ? 1 : max(0.01, cos(total / lats.size() * M_PI / 180));
+	
+	Points.clear();
+	Points.reserve(positions.size());
+	Pending.clear();
+	NumRemoved = 0;
+	
+	for (size_t i = 0; i < positions.size(); i++)
+		Points.push_back(_point(lats[i], lons[i], positions[i]));
+	
+	_build(0, Points.size(), 0);
+}
+
+
+//
+// spatialindex::height
+//
+// Returns the # of levels in the tree, about log2(n).
+//
+int spatialindex::height() const
+{
+	int levels = 0;
+	
+	for (size_t n = Points.size(); n > 0; n /= 2)
+		levels++;
+	
+	return levels;
+}
+
+
+//
+// spatialindex::add
+//
+// Adds the point of a newly inserted record.  It waits in the pending
+// list until there are enough pending points to be worth a rebuild.
+//
+void spatialindex::add(double lat, double lon, streamoff pos)
+{
+	Pending.push_back(_point(lat, lon, pos));
+	
+	if (Pending.size() > max((size_t) 64, Points.size() / 16))
+		_rebuild();
+}
+
+
+//
+// spatialindex::_remove
+//
+// Marks the point in Points[low, high) removed, see below.  Points equal
+// to a median on its coordinate can be on either side of it.
+//
+bool spatialindex::_remove(size_t low, size_t high, int depth, const POINT& point)
+{
+	if (low >= high)
+		return false;
+	
+	size_t mid = low + (high - low) / 2;
+	POINT& node = Points[mid];
+	
+	if (node.Pos == point.Pos && node.X == point.X && node.Y == point.Y)
+	{
+		node.Pos = -1;
+		return true;
+	}
+	
+	double diff = (depth % 2 == 0) ? point.Y - node.Y : point.X - node.X;
+	
+	if (diff <= 0 && _remove(low, mid, depth + 1, point))
+		return true;
+	
+	return diff >= 0 && _remove(mid + 1, high, depth + 1, point);
+}
+
+
+//
+// spatialindex::remove
+//
+// Removes the point of a deleted record, given the latitude and
+// longitude it was indexed with.
+//
+void spatialindex::remove(double lat, double lon, streamoff pos)
+{
+	POINT point = _point(lat, lon, pos);
+	
+	for (size_t i = 0; i < Pending.size(); i++)
+	{
+		if (Pending[i].Pos == pos)
+		{
+			Pending.erase(Pending.begin() + i);
+			return;
+		}
+	}
+	
+	if (!_remove(0, Points.size(), 0, point))
+		return;
+	
+	// once half the tree is dead, searches are wasting their time
+	NumRemoved++;
+	
+	if (NumRemoved > Points.size() / 2)
+		_rebuild();
+}
+
+
+//
+// spatialindex::_within
+//
+// Adds the positions of the points in Points[low, high) inside the
+// box [lowest, highest], skipping halves that lie outside it.
+//
+void spatialindex::_within(size_t low, size_t high, int depth, const POINT& lowest, const POINT& highest,
+						   vector<streamoff>& result) const
+{
+	while (low < high)
+	{
+		size_t mid = low + (high - low) / 2;
+		const POINT& node = Points[mid];
+		
+		StatCount(COUNT_NODESVISITED, 1);
+		
+		if (node.Pos >= 0 && node.X >= lowest.X && node.X <= highest.X && node.Y >= lowest.Y && node.Y <= highest.Y)
+			result.push_back(node.Pos);
+		
+		double value = (depth % 2 == 0) ? node.Y : node.X;
+		double first = (depth % 2 == 0) ? lowest.Y : lowest.X;
+		double last = (depth % 2 == 0) ? highest.Y : highest.X;
+		
+		// search the left half if the box reaches it, loop on the right
+		if (first <= value)
+			_within(low, mid, depth + 1, lowest, highest, result);
+		
+		if (last < value)
+			return;
+		
+		low = mid + 1;
+		depth++;
+	}
+}
+
+
+//
+// spatialindex::within
+//
+// Returns the positions of the records inside the box with corners
+// (lat1, lon1) and (lat2, lon2), in file order.
+//
+vector<streamoff> spatialindex::within(double lat1, double lon1, double lat2, double lon2) const
+{
+	POINT lowest = _point(min(lat1, lat2), min(lon1, lon2), 0);
+	POINT highest = _point(max(lat1, lat2), max(lon1, lon2), 0);
+	vector<streamoff> result;
+	
+	StatCount(COUNT_SEARCHES, 1);
+	
+	_within(0, Points.size(), 0, lowest, highest, result);
+	
+	for (const POINT& point : Pending)
+	{
+		if (point.X >= lowest.X && point.X <= highest.X && point.Y >= lowest.Y && point.Y <= highest.Y)
+			result.push_back(point.Pos);
+	}
+	
+	sort(result.begin(), result.end());
+	return result;
+}
+
+
+//
+// _offer
+//
+// Offers a point (by # in Points, then Pending) at the given squared
+// distance to heap, a max-heap of the k closest found so far.
+//
+static void _offer(vector<pair<double, size_t>>& heap, size_t k, double distance, size_t point)
+{
+	if (heap.size() == k && distance >= heap.front().first)
+		return;
+	
+	heap.push_back(make_pair(distance, point));
+	push_heap(heap.begin(), heap.end());
+	
+	if (heap.size() > k)
+	{
+		pop_heap(heap.begin(), heap.end());
+		heap.pop_back();
+	}
+}
+
+
+//
+// spatialindex::_nearest
+//
+// Offers the points in Points[low, high) to heap by their squared
+// projected distance from point.  The half on the point's side of each
+// median is searched first; the other half only if it could hold
+// something closer than the farthest of the k found so far.
+//
+void spatialindex::_nearest(size_t low, size_t high, int depth, const POINT& point, size_t k,
+							vector<pair<double, size_t>>& heap) const
+{
+	if (low >= high)
+		return;
+	
+	size_t mid = low + (high - low) / 2;
+	const POINT& node = Points[mid];
+	
+	StatCount(COUNT_NODESVISITED, 1);
+	
+	if (node.Pos >= 0)
+	{
+		double dx = node.X - point.X, dy = node.Y - point.Y;
+		_offer(heap, k, dx * dx + dy * dy, mid);
+	}
+	
+	double diff = (depth % 2 == 0) ? point.Y - node.Y : point.X - node.X;
+	
+	if (diff < 0)
+		_nearest(low, mid, depth + 1, point, k, heap);
+	else
+		_nearest(mid + 1, high, depth + 1, point, k, heap);
+	
+	if (heap.size() < k || diff * diff < heap.front().first)
+	{
+		if (diff < 0)
+			_nearest(mid + 1, high, depth + 1, point, k, heap);
+		else
+			_nearest(low, mid, depth + 1, point, k, heap);
+	}
+}
+
+
+//
+// spatialindex::nearest
+//
+// Returns the k records closest to (lat, lon) as (distance in km,
+// position) pairs, nearest first.
+//
+vector<pair<double, streamoff>> spatialindex::nearest(size_t k, double lat, double lon) const
+{
+	POINT point = _point(lat, lon, 0);
+	vector<pair<double, size_t>> heap;
+	vector<pair<double, streamoff>> result;
+	
+	if (k == 0)
+		return result;
+	
+	StatCount(COUNT_SEARCHES, 1);
+	
+	_nearest(0, Points.size(), 0, point, k, heap);
+	
+	// pending points aren't in the tree, so offer each of them too
+	for (size_t i = 0; i < Pending.size(); i++)
+	{
+		double dx = Pending[i].X - point.X, dy = Pending[i].Y - point.Y;
+		_offer(heap, k, dx * dx + dy * dy, Points.size() + i);
+	}
+	
+	for (const pair<double, size_t>& found : heap)
+	{
+		const POINT& p = (found.second < Points.size()) ? Points[found.second] : Pending[found.second - Points.size()];
+		result.push_back(make_pair(GreatCircleKm(lat, lon, p.Y, p.X / Scale), p.Pos));
+	}
+	
+	sort(result.begin(), result.end());
+	return result;
+}
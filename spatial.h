@@ -0,0 +1,79 @@
+/*spatial.h*/
+
+// Spatial (latitude/longitude) index for myDB project
+
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <utility>
+
+using namespace std;
+
+//
+// spatialindex
+//
+// A k-d tree of every record's (latitude, longitude) point, for box and
+// nearest-neighbor queries in O(log n) instead of a scan.  The tree is
+// implicit: Points holds it in place, the median of each range splitting
+// it on latitude or longitude (alternating by depth), like a binary
+// search over a sorted array.
+//
+// Distances are measured on a flat projection around the mean latitude
+// of the table (longitudes scaled by its cosine), which is accurate for
+// a city-sized table; the distances reported are great-circle km.
+//
+// Points added after the tree was built wait in a pending list that
+// queries check one by one, until there are enough of them to rebuild
+// the tree.  Removed points stay in the tree, marked by a position of -1.
+//
+class spatialindex
+{
+private:
+	struct POINT
+	{
+		double X;      // longitude, scaled by Scale
+		double Y;      // latitude
+		streamoff Pos; // record position, -1 once removed
+	};
+	
+	vector<POINT> Points;  // the k-d tree
+	vector<POINT> Pending; // points added since the tree was built
+	double Scale;          // cosine of the mean latitude
+	size_t NumRemoved;
+	
+	void _build(size_t low, size_t high, int depth);
+	void _rebuild();
+	POINT _point(double lat, double lon, streamoff pos) const;
+	bool _remove(size_t low, size_t high, int depth, const POINT& point);
+	void _within(size_t low, size_t high, int depth, const POINT& lowest, const POINT& highest,
+				 vector<streamoff>& result) const;
+	void _nearest(size_t low, size_t high, int depth, const POINT& point, size_t k,
+				  vector<pair<double, size_t>>& heap) const;
+
+public:
+	spatialindex()
+		: Scale(1), NumRemoved(0)
+	{
+	}
+	
+	// size function (# of points in the index)
+	size_t size() const
+	{
+		return Points.size() + Pending.size() - NumRemoved;
+	}
+	
+	int height() const;
+	
+	void build(const vector<double>& lats, const vector<double>& lons, const vector<streamoff>& positions);
+	
+	void add(double lat, double lon, streamoff pos);
+	
+	void remove(double lat, double lon, streamoff pos);
+	
+	vector<streamoff> within(double lat1, double lon1, double lat2, double lon2) const;
+	
+	vector<pair<double, streamoff>> nearest(size_t k, double lat, double lon) const;
+};
+
+double GreatCircleKm(double lat1, double lon1, double lat2, double lon2);
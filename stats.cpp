@@ -0,0 +1,312 @@
+/*stats.cpp*/
+
+// Hot-path instrumentation for myDB project
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <algorithm>
+#include <memory>
+#include <cstdio>
+
+#include "stats.h"
+
+using namespace std;
+
+atomic<bool> StatsEnabled(false);
+
+// every live thread's stats, plus the sums of threads that have exited
+static mutex Registry;
+static vector<STATSLOCAL*> Threads;
+static STATSLOCAL* Retired = nullptr;
+
+// bumped by ResetStats; a thread's stats from an older epoch count as zero
+static atomic<uint64_t> ResetEpoch(0);
+
+static const char* TIMERNAMES[NUMTIMERS] =
+	{ "query", "tokenize", "index search", "GetRecord", "LinearSearch", "index build" };
+
+
+//
+// _add
+//
+// Adds n to a per-thread value (only its own thread writes it).
+//
+static void _add(atomic<uint64_t>& value, uint64_t n)
+{
+	value.store(value.load(memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+
+//
+// _merge
+//
+// Adds one set of stats into another.
+//
+static void _merge(STATSLOCAL& into, const STATSLOCAL& from)
+{
+	for (int c = 0; c < NUMCOUNTERS; c++)
+		_add(into.Counts[c], from.Counts[c].load(memory_order_relaxed));
+	
+	for (int t = 0; t < NUMTIMERS; t++)
+	{
+		_add(into.Calls[t], from.Calls[t].load(memory_order_relaxed));
+		_add(into.TotalNs[t], from.TotalNs[t].load(memory_order_relaxed));
+		into.MaxNs[t].store(max(into.MaxNs[t].load(memory_order_relaxed),
+								from.MaxNs[t].load(memory_order_relaxed)), memory_order_relaxed);
+		
+		for (int b = 0; b < STATBUCKETS; b++)
+			_add(into.Buckets[t][b], from.Buckets[t][b].load(memory_order_relaxed));
+	}
+}
+
+
+//
+// _bucket/_bucketvalue
+//
+// Latency histogram bucket of a time in ns, and the largest time in a
+// bucket (what a percentile falling in it reports).
+//
+static int _bucket(uint64_t ns)
+{
+	if (ns < 16)
+		return (int) ns;
+	
+	int power = 63 - __builtin_clzll(ns);  // >= 4
+	int sub = (int) ((ns >> (power - 3)) & 7);
+	
+	return 16 + (power - 4) * 8 + sub;
+}
+
+static uint64_t _bucketvalue(int bucket)
+{
+	if (bucket < 16)
+		return bucket;
+	
+	int power = (bucket - 16) / 8 + 4;
+	int sub = (bucket - 16) % 8;
+	
+	return ((uint64_t) (8 + sub + 1) << (power - 3)) - 1;
+}
+
+
+// constructor (registers the thread's stats)
+STATSLOCAL::STATSLOCAL(bool registered)
+{
+	Registered = registered;
+	Epoch.store(ResetEpoch.load(memory_order_relaxed), memory_order_relaxed);
+	clear();
+	
+	if (Registered)
+	{
+		lock_guard<mutex> guard(Registry);
+		Threads.push_back(this);
+	}
+}
+
+// destructor (folds a thread's stats into the retired sums)
+STATSLOCAL::~STATSLOCAL()
+{
+	if (!Registered)
+		return;
+	
+	lock_guard<mutex> guard(Registry);
+	
+	Threads.erase(find(Threads.begin(), Threads.end(), this));
+	
+	if (Retired == nullptr)
+		Retired = new STATSLOCAL(false);
+	
+	// stats from before the last reset are dropped, not kept
+	if (Epoch.load(memory_order_acquire) == ResetEpoch.load(memory_order_relaxed))
+		_merge(*Retired, *this);
+}
+
+
+//
+// clear
+//
+// Zeroes every timer and counter.
+//
+void STATSLOCAL::clear()
+{
+	for (int c = 0; c < NUMCOUNTERS; c++)
+		Counts[c].store(0, memory_order_relaxed);
+	
+	for (int t = 0; t < NUMTIMERS; t++)
+	{
+		Calls[t].store(0, memory_order_relaxed);
+		TotalNs[t].store(0, memory_order_relaxed);
+		MaxNs[t].store(0, memory_order_relaxed);
+		
+		for (int b = 0; b < STATBUCKETS; b++)
+			Buckets[t][b].store(0, memory_order_relaxed);
+	}
+}
+
+
+//
+// LocalStats
+//
+// Returns the calling thread's stats, created on first use (threads
+// that never record anything don't carry the histograms), and cleared
+// by the thread itself on first use after a ResetStats.
+//
+STATSLOCAL& LocalStats()
+{
+	static thread_local unique_ptr<STATSLOCAL> local;
+	
+	if (!local)
+		local.reset(new STATSLOCAL());
+	
+	uint64_t epoch = ResetEpoch.load(memory_order_acquire);
+	
+	if (local->Epoch.load(memory_order_relaxed) != epoch)
+	{
+		local->clear();
+		local->Epoch.store(epoch, memory_order_release);
+	}
+	
+	return *local;
+}
+
+
+//
+// StatTime
+//
+// Records one call of a timer that took ns nanoseconds.
+//
+void StatTime(stattimer timer, uint64_t ns)
+{
+	STATSLOCAL& local = LocalStats();
+	
+	_add(local.Calls[timer], 1);
+	_add(local.TotalNs[timer], ns);
+	_add(local.Buckets[timer][_bucket(ns)], 1);
+	
+	if (ns > local.MaxNs[timer].load(memory_order_relaxed))
+		local.MaxNs[timer].store(ns, memory_order_relaxed);
+}
+
+
+//
+// _sum
+//
+// Sums every thread's stats (live and exited) into total, skipping
+// threads that haven't cleared theirs since the last ResetStats.
+//
+static void _sum(STATSLOCAL& total)
+{
+	lock_guard<mutex> guard(Registry);
+	
+	uint64_t epoch = ResetEpoch.load(memory_order_relaxed);
+	
+	for (size_t i = 0; i < Threads.size(); i++)
+	{
+		if (Threads[i]->Epoch.load(memory_order_acquire) == epoch)
+			_merge(total, *Threads[i]);
+	}
+	
+	if (Retired != nullptr)
+		_merge(total, *Retired);
+}
+
+
+//
+// _percentile
+//
+// Returns the p-th percentile (0..100) of a timer's histogram, in ns.
+//
+static uint64_t _percentile(const STATSLOCAL& total, int timer, double p)
+{
+	uint64_t calls = total.Calls[timer].load(memory_order_relaxed);
+	uint64_t rank = (uint64_t) (p / 100.0 * calls + 0.5);
+	uint64_t seen = 0;
+	
+	rank = max(rank, (uint64_t) 1);
+	
+	for (int b = 0; b < STATBUCKETS; b++)
+	{
+		seen += total.Buckets[timer][b].load(memory_order_relaxed);
+		
+		if (seen >= rank)
+			return min(_bucketvalue(b), total.MaxNs[timer].load(memory_order_relaxed));
+	}
+	
+	return total.MaxNs[timer].load(memory_order_relaxed);
+}
+
+
+//
+// _microseconds
+//
+// Formats a time in ns as microseconds.
+//
+static string _microseconds(uint64_t ns)
+{
+	char buffer[32];
+	
+	snprintf(buffer, sizeof(buffer), "%.1f us", ns / 1000.0);
+	
+	return buffer;
+}
+
+
+//
+// PrintStats
+//
+// Outputs the latency of every timer that was called (calls, p50, p99,
+// max and total) and every counter, summed over all threads.
+//
+void PrintStats(ostream& output)
+{
+	// the sums are too big for the stack
+	unique_ptr<STATSLOCAL> total(new STATSLOCAL(false));
+	
+	_sum(*total);
+	
+	if (!StatsEnabled.load(memory_order_relaxed))
+		output << "Stats are off, turn them on with 'stats on'...\n";
+	
+	for (int t = 0; t < NUMTIMERS; t++)
+	{
+		uint64_t calls = total->Calls[t].load(memory_order_relaxed);
+		
+		if (calls == 0)
+			continue;
+		
+		output << TIMERNAMES[t] << ": " << calls << " call(s), p50 " << _microseconds(_percentile(*total, t, 50))
+			   << ", p99 " << _microseconds(_percentile(*total, t, 99))
+			   << ", max " << _microseconds(total->MaxNs[t].load(memory_order_relaxed))
+			   << ", total " << _microseconds(total->TotalNs[t].load(memory_order_relaxed)) << "\n";
+	}
+	
+	uint64_t searches = total->Counts[COUNT_SEARCHES].load(memory_order_relaxed);
+	uint64_t nodes = total->Counts[COUNT_NODESVISITED].load(memory_order_relaxed);
+	
+	output << "Bytes read: " << total->Counts[COUNT_BYTESREAD].load(memory_order_relaxed) << "\n";
+	output << "File opens: " << total->Counts[COUNT_FILEOPENS].load(memory_order_relaxed) << "\n";
+	output << "Tree searches: " << searches << ", nodes visited per search: "
+		   << (searches > 0 ? (double) nodes / searches : 0) << "\n";
+	output << "Tree rotations (inserts and erases): " << total->Counts[COUNT_ROTATIONS].load(memory_order_relaxed) << "\n";
+}
+
+
+//
+// ResetStats
+//
+// Zeroes the stats of every thread: starts a new epoch, so each live
+// thread's stats read as zero until that thread clears them itself on
+// its next record (no thread ever stores into another's).  The retired
+// sums belong to no thread and are cleared here, under the lock.
+//
+void ResetStats()
+{
+	lock_guard<mutex> guard(Registry);
+	
+	ResetEpoch.fetch_add(1, memory_order_acq_rel);
+	
+	if (Retired != nullptr)
+		Retired->clear();
+}
@@ -0,0 +1,120 @@
+/*stats.h*/
+
+// Hot-path instrumentation for myDB project
+
+#pragma once
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+using namespace std;
+
+//
+// Instrumentation
+//
+// Timers record how long each call of an instrumented function took
+// into a latency histogram; counters add up events (bytes read, nodes
+// visited, ...).  Both are kept per thread, so recording never contends,
+// and are only summed up when printed.  Everything is off unless
+// StatsEnabled is set: then a timer costs two clock reads and a counter
+// an add, and while off each costs a single test of the flag (a relaxed
+// atomic load, since "stats on" may flip it while other threads run).
+//
+enum stattimer
+{
+	TIME_QUERY,        // whole query, ExecuteQuery
+	TIME_TOKENIZE,
+	TIME_INDEXSEARCH,
+	TIME_GETRECORD,
+	TIME_LINEARSEARCH,
+	TIME_INDEXBUILD,   // startup: load or rebuild every index tree
+	NUMTIMERS
+};
+
+enum statcounter
+{
+	COUNT_BYTESREAD,     // bytes of the data or index files read
+	COUNT_FILEOPENS,
+	COUNT_SEARCHES,      // tree searches and descents
+	COUNT_NODESVISITED,  // nodes visited by those searches
+	COUNT_ROTATIONS,     // avltree/compactavltree rotations by inserts and erases (bulk builds need none)
+	NUMCOUNTERS
+};
+
+// latency buckets: exact below 16 ns, then 8 per power of two
+static const int STATBUCKETS = 16 + 60 * 8;
+
+extern atomic<bool> StatsEnabled;
+
+//
+// STATSLOCAL
+//
+// One thread's timers and counters.  Only the owning thread writes them
+// (relaxed, no locked instructions), including clearing them after a
+// ResetStats; PrintStats reads every thread's.  Registered ones belong
+// to a thread; unregistered ones hold sums.
+//
+struct STATSLOCAL
+{
+	atomic<uint64_t> Counts[NUMCOUNTERS];
+	atomic<uint64_t> Calls[NUMTIMERS];
+	atomic<uint64_t> TotalNs[NUMTIMERS];
+	atomic<uint64_t> MaxNs[NUMTIMERS];
+	atomic<uint64_t> Buckets[NUMTIMERS][STATBUCKETS];
+	
+	atomic<uint64_t> Epoch;  // reset epoch the counters were last cleared in
+	bool Registered;
+	
+	STATSLOCAL(bool registered = true);
+	~STATSLOCAL();
+	
+	void clear();
+};
+
+STATSLOCAL& LocalStats();
+
+void StatTime(stattimer timer, uint64_t ns);
+
+// StatCount function (add n to a counter of this thread)
+inline void StatCount(statcounter counter, uint64_t n)
+{
+	if (StatsEnabled.load(memory_order_relaxed))
+	{
+		atomic<uint64_t>& count = LocalStats().Counts[counter];
+		count.store(count.load(memory_order_relaxed) + n, memory_order_relaxed);
+	}
+}
+
+//
+// scopedtimer
+//
+// Times its own lifetime into a timer:
+//
+//   { scopedtimer timer(TIME_GETRECORD);  ...timed work... }
+//
+class scopedtimer
+{
+private:
+	stattimer Timer;
+	bool On;
+	chrono::steady_clock::time_point Start;
+	
+public:
+	scopedtimer(stattimer timer) : Timer(timer), On(StatsEnabled.load(memory_order_relaxed))
+	{
+		if (On)
+			Start = chrono::steady_clock::now();
+	}
+	
+	~scopedtimer()
+	{
+		if (On)
+			StatTime(Timer, chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - Start).count());
+	}
+};
+
+void PrintStats(ostream& output);
+
+void ResetStats();
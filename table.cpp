@@ -0,0 +1,311 @@
+/*table.cpp*/
+
+// Memory-mapped access to a table's fixed-width .data file for myDB project
+
+#include <iostream>
+#include <string>
+#include <cctype>
+#include <algorithm>
+#include <limits>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "table.h"
+#include "stats.h"
+
+using namespace std;
+
+
+//
+// _nextfield
+//
+// Finds the next whitespace-separated value at or after cur and before
+// end, the same way >> would.  Returns the view, with a 0 length if the
+// record has no more values.
+//
+static fieldview _nextfield(const char*& cur, const char* end)
+{
+	fieldview field;
+	
+	while (cur < end && isspace((unsigned char) *cur))
+		cur++;
+	
+	field.Data = cur;
+	
+	while (cur < end && !isspace((unsigned char) *cur))
+		cur++;
+	
+	field.Length = cur - field.Data;
+	
+	return field;
+}
+
+
+// default constructor
+datatable::datatable()
+{
+	Fd = -1;
+	Writable = false;
+	Base = nullptr;
+	Length = 0;
+	RecordSize = 0;
+	NumColumns = 0;
+	PageSize = numeric_limits<streamoff>::max();
+	Pool = nullptr;
+}
+
+// destructor
+datatable::~datatable()
+{
+	close();
+}
+
+
+//
+// open
+//
+// Opens and maps "<tablename>.data".  Pass the table name, the record
+// size and the # of columns per record, plus a buffer pool budget in
+// bytes to read the file through a pool instead of mapping it (0 maps
+// it).  Returns false if the file couldn't be opened or mapped.
+//
+bool datatable::open(string tablename, int recordSize, int numColumns, size_t poolBudget)
+{
+	close();
+	
+	// open for writing too if we can, so records can be deleted
+	string filename = tablename + ".data";
+	int fd = ::open(filename.c_str(), O_RDWR);
+	bool writable = (fd >= 0);
+	
+	if (fd < 0)
+		fd = ::open(filename.c_str(), O_RDONLY);
+	
+	StatCount(COUNT_FILEOPENS, 1);
+	
+	if (fd < 0)
+		return false;
+	
+	struct stat info;
+	if (fstat(fd, &info) != 0)
+	{
+		::close(fd);
+		return false;
+	}
+	
+	// read through a pool, with pages of whole records
+	if (poolBudget > 0 && recordSize > 0)
+	{
+		PageSize = max((size_t) 1, POOLPAGE / recordSize) * recordSize;
+		Pool = new bufferpool(fd, PageSize, poolBudget);
+	}
+	// an empty file can't be mapped, but it is still a valid (empty) table
+	else if (info.st_size > 0)
+	{
+		void* mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		
+		if (mapping == MAP_FAILED)
+		{
+			::close(fd);
+			return false;
+		}
+		
+		Base = (char*) mapping;
+	}
+	
+	Fd = fd;
+	Writable = writable;
+	Length = info.st_size;
+	RecordSize = recordSize;
+	NumColumns = numColumns;
+	
+	return true;
+}
+
+
+//
+// close
+//
+// Unmaps and closes the data file, if one is open.
+//
+void datatable::close()
+{
+	if (Base != nullptr)
+		munmap(Base, Length);
+	
+	delete Pool;
+	
+	if (Fd >= 0)
+		::close(Fd);
+	
+	Fd = -1;
+	Writable = false;
+	Base = nullptr;
+	Length = 0;
+	PageSize = numeric_limits<streamoff>::max();
+	Pool = nullptr;
+}
+
+
+//
+// deleted
+//
+// Returns true if the record at the given offset is a tombstone.
+//
+bool datatable::deleted(streamoff pos) const
+{
+	recordpin pin;
+	
+	return *pin.at(*this, pos) == '.';
+}
+
+
+//
+// column
+//
+// Returns a view of the given column (0-based) of the record at the
+// given offset.  The view has a 0 length if the record is short.  The
+// caller must hold a recordpin on the record while using the view.
+//
+fieldview datatable::column(streamoff pos, int column) const
+{
+	recordpin pin;
+	
+	// clip to the end of the file so a short last record is safe
+	streamoff endpos = min(pos + RecordSize, Length);
+	const char* cur = pin.at(*this, min(pos, endpos));
+	const char* end = cur + (endpos - min(pos, endpos));
+	fieldview field = _nextfield(cur, end);
+	
+	for (int i = 0; i < column; i++)
+		field = _nextfield(cur, end);
+	
+	return field;
+}
+
+
+//
+// columns
+//
+// Fills fields[0..numcolumns) with views of every column of the record
+// at the given offset.  Returns the # of columns filled.  The caller
+// must hold a recordpin on the record while using the views.
+//
+int datatable::columns(streamoff pos, fieldview* fields) const
+{
+	recordpin pin;
+	
+	// clip to the end of the file so a short last record is safe
+	streamoff endpos = min(pos + RecordSize, Length);
+	const char* cur = pin.at(*this, min(pos, endpos));
+	const char* end = cur + (endpos - min(pos, endpos));
+	
+	for (int i = 0; i < NumColumns; i++)
+		fields[i] = _nextfield(cur, end);
+	
+	return NumColumns;
+}
+
+
+//
+// erase
+//
+// Deletes the record at the given offset by overwriting its values with
+// '.' padding in the data file (the line ending is kept), making it a
+// tombstone.  The mapping is shared, so the change shows up in it right
+// away; a pool copies it into the page if resident.  Returns false if
+// the file couldn't be written.
+//
+bool datatable::erase(streamoff pos)
+{
+	if (!Writable || pos < 0 || pos + RecordSize > Length)
+		return false;
+	
+	// keep the record's line ending, pad everything before it
+	int padlength = RecordSize;
+	{
+		recordpin pin;
+		const char* record = pin.at(*this, pos);
+		
+		while (padlength > 0 && (record[padlength - 1] == '\n' || record[padlength - 1] == '\r'))
+			padlength--;
+	}
+	
+	string padding(padlength, '.');
+	
+	if (pwrite(Fd, padding.data(), padlength, pos) != padlength)
+		return false;
+	
+	if (Pool != nullptr)
+		Pool->write(pos, padding.data(), padlength);
+	
+	return true;
+}
+
+
+//
+// lineending
+//
+// Returns the line ending the table's records use ("\r\n" or "\n"),
+// taken from the first record; "\n" if the table is empty.
+//
+string datatable::lineending() const
+{
+	if (Length < RecordSize || RecordSize < 2)
+		return "\n";
+	
+	recordpin pin;
+	const char* record = pin.at(*this, 0);
+	
+	if (record[RecordSize - 2] == '\r' && record[RecordSize - 1] == '\n')
+		return "\r\n";
+	else
+		return "\n";
+}
+
+
+//
+// append
+//
+// Appends whole records (a multiple of the record size, already padded)
+// to the end of the data file with one write, then remaps the file so
+// the new records can be read (a pool copies them into its resident
+// pages instead).  Returns false if the file couldn't be written.
+//
+bool datatable::append(const string& records)
+{
+	if (!Writable || RecordSize == 0 || records.size() % RecordSize != 0)
+		return false;
+	
+	// start at the end of the last whole record, a torn tail is overwritten
+	streamoff pos = numrecords() * RecordSize;
+	
+	if (pwrite(Fd, records.data(), records.size(), pos) != (ssize_t) records.size())
+		return false;
+	
+	streamoff newlength = pos + records.size();
+	
+	if (Pool != nullptr)
+	{
+		Pool->write(pos, records.data(), records.size());
+		Length = newlength;
+		return true;
+	}
+	
+	// remap at the new size
+	void* mapping = mmap(nullptr, newlength, PROT_READ, MAP_SHARED, Fd, 0);
+	
+	if (mapping == MAP_FAILED)
+		return false;
+	
+	if (Base != nullptr)
+		munmap(Base, Length);
+	
+	Base = (char*) mapping;
+	Length = newlength;
+	
+	return true;
+}
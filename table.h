@@ -0,0 +1,182 @@
+/*table.h*/
+
+// Memory-mapped access to a table's fixed-width .data file for myDB project
+
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+
+#include "pool.h"
+
+using namespace std;
+
+//
+// fieldview
+//
+// A view of one column value inside a mapped record: a pointer into the
+// mapping plus a length.  No copy is made; the view stays valid as long
+// as the datatable it came from stays open.
+//
+struct fieldview
+{
+	const char* Data;
+	size_t Length;
+	
+	// str function (copy the value out into a string)
+	string str() const
+	{
+		return string(Data, Length);
+	}
+	
+	// equals function (compare the value against a string)
+	bool equals(const string& value) const
+	{
+		return Length == value.size() && memcmp(Data, value.data(), Length) == 0;
+	}
+};
+
+//
+// datatable
+//
+// Maps a table's .data file into memory once and hands out record and
+// column views into the mapping.  Records are fixed width (record size
+// is line 1 of the .meta file), so a record is found by its offset
+// without any seeking, reading or allocation.
+//
+// A table can instead be opened with a buffer pool budget, in which case
+// nothing is mapped and the file is read in pages through a bufferpool.
+// Page boundaries always fall between records.  Either way, a record is
+// read through a recordpin (below), and views of its columns are only
+// valid while the record is pinned.  When mapped, the whole file is one
+// page that is always resident.
+//
+// A deleted record is a tombstone: its values are overwritten with the
+// '.' padding, so it starts with '.' instead of a value.
+//
+class datatable
+{
+private:
+	int Fd;
+	bool Writable;
+	char* Base;
+	streamoff Length;
+	int RecordSize;
+	int NumColumns;
+	streamoff PageSize;
+	bufferpool* Pool;
+	
+	// no copies, the mapping is owned by exactly one table
+	datatable(const datatable& other);
+	datatable& operator=(const datatable& other);
+	
+public:
+	// bytes per buffer pool page, rounded down to whole records
+	static const size_t POOLPAGE = 8192;
+	
+	datatable();
+	virtual ~datatable();
+	
+	bool open(string tablename, int recordSize, int numColumns, size_t poolBudget = 0);
+	void close();
+	
+	// good function (true if a data file is open)
+	bool good() const { return Fd >= 0; }
+	
+	int recordsize() const { return RecordSize; }
+	int numcolumns() const { return NumColumns; }
+	
+	// length function (bytes of the data file)
+	streamoff length() const { return Length; }
+	
+	// numrecords function (# of whole records in the data file)
+	streamoff numrecords() const { return RecordSize > 0 ? Length / RecordSize : 0; }
+	
+	// pool function (the buffer pool, nullptr if the file is mapped)
+	const bufferpool* pool() const { return Pool; }
+	
+	// pagesize function (bytes per page, see recordpin)
+	streamoff pagesize() const { return PageSize; }
+	
+	// pinpage/unpinpage functions (pin the page # while reading it)
+	const char* pinpage(streamoff page) const { return Pool == nullptr ? Base : Pool->pin(page); }
+	void unpinpage(streamoff page) const { if (Pool != nullptr) Pool->unpin(page); }
+	
+	bool deleted(streamoff pos) const;
+	
+	fieldview column(streamoff pos, int column) const;
+	int columns(streamoff pos, fieldview* fields) const;
+	
+	string lineending() const;
+	
+	bool erase(streamoff pos);
+	bool append(const string& records);
+};
+
+//
+// recordpin
+//
+// Keeps the page of the record being read pinned, and gives the record's
+// address.  Moving on to a record in the same page costs nothing, so
+// scans keep one recordpin for the whole walk:
+//
+//   recordpin pin;
+//   for (...) { const char* record = pin.at(table, pos); ... }
+//
+// The page is unpinned when the recordpin moves to another page or goes
+// away.
+//
+class recordpin
+{
+private:
+	const datatable* Table;
+	streamoff Page;
+	const char* Data;
+	
+	// no copies, each pin is released once
+	recordpin(const recordpin& other);
+	recordpin& operator=(const recordpin& other);
+	
+public:
+	recordpin() : Table(nullptr), Page(-1), Data(nullptr) {}
+	
+	recordpin(const datatable& table, streamoff pos) : Table(nullptr), Page(-1), Data(nullptr)
+	{
+		at(table, pos);
+	}
+	
+	~recordpin()
+	{
+		release();
+	}
+	
+	// at function (pin the record at given offset and return its address)
+	const char* at(const datatable& table, streamoff pos)
+	{
+		streamoff page = pos / table.pagesize();
+		
+		if (Table != &table || Page != page)
+		{
+			release();
+			
+			Data = table.pinpage(page);
+			Table = &table;
+			Page = page;
+		}
+		
+		return Data + (pos - page * table.pagesize());
+	}
+	
+	// release function (unpin the current page, if any)
+	void release()
+	{
+		if (Table != nullptr)
+			Table->unpinpage(Page);
+		
+		Table = nullptr;
+		Page = -1;
+		Data = nullptr;
+	}
+};
@@ -2,8 +2,15 @@
 
 #include <iostream>
 #include <vector>
+#include <string>
+#include <map>
+#include <set>
+#include <random>
+#include <algorithm>
 
 #include "avl.h"
+#include "hashtable.h"
+#include "spatial.h"
 #include "util.h"
 
 #define CATCH_CONFIG_MAIN
@@ -11,7 +18,277 @@
 
 using namespace std;
 
-TEST_CASE("(1) ???") 
+// keys of a map, in order
+template<typename TKey, typename TValue>
+static vector<TKey> _keys(const map<TKey, TValue>& model)
 {
+	vector<TKey> keys;
 	
+	for (auto& pair : model)
+		keys.push_back(pair.first);
+	
+	return keys;
+}
+
+TEST_CASE("(1) avltree stays balanced and in order through random inserts and erases") 
+{
+	avltree<int, int> tree;
+	map<int, int> model;
+	mt19937 random(251);
+	
+	for (int round = 0; round < 40; round++)
+	{
+		// a small key range, so erases hit keys that are there
+		for (int i = 0; i < 200; i++)
+		{
+			int key = (int) (random() % 1000);
+			
+			if (random() % 3 == 0)
+			{
+				REQUIRE(tree.erase(key) == (model.erase(key) == 1));
+			}
+			else
+			{
+				tree.insert(key, key * 2);
+				model.insert(make_pair(key, key * 2));
+			}
+		}
+		
+		REQUIRE(tree.balanced());
+		REQUIRE(tree.size() == (int) model.size());
+		REQUIRE(tree.inorder_keys() == _keys(model));
+	}
+	
+	for (auto& pair : model)
+	{
+		int* value = tree.search(pair.first);
+		
+		REQUIRE(value != nullptr);
+		REQUIRE(*value == pair.second);
+	}
+	
+	// erase everything, half from each end, so the rotations go both ways
+	vector<int> keys = _keys(model);
+	
+	for (size_t i = 0; i < keys.size(); i++)
+	{
+		int key = (i % 2 == 0) ? keys[i / 2] : keys[keys.size() - 1 - i / 2];
+		
+		REQUIRE(tree.erase(key));
+		REQUIRE(tree.balanced());
+	}
+	
+	REQUIRE(tree.size() == 0);
+	REQUIRE(tree.height() == -1);
+}
+
+TEST_CASE("(2) avltree stays balanced through sorted inserts and erases") 
+{
+	avltree<int, int> tree;
+	
+	for (int key = 0; key < 1000; key++)
+		tree.insert(key, key);
+	
+	REQUIRE(tree.balanced());
+	REQUIRE(tree.height() <= 10);
+	
+	for (int key = 999; key >= 0; key -= 2)
+	{
+		REQUIRE(tree.erase(key));
+		REQUIRE(tree.balanced());
+	}
+	
+	REQUIRE(tree.size() == 500);
+	REQUIRE(tree.inorder_keys().front() == 0);
+	REQUIRE(tree.inorder_keys().back() == 998);
+}
+
+TEST_CASE("(3) frozentree bounds across the shared prefix and ordinal runs") 
+{
+	// every key shares "nid/"; the 8 bytes after it (the ordinal) repeat
+	// across keys that only differ later, making runs of equal ordinals
+	vector<string> groups = { "aaaaaaaa", "aaaaaaab", "abc", "abcdefgh", "b" };
+	vector<string> tails = { "", "0", "00", "1", "z" };
+	avltree<string, int> tree;
+	set<string> model;
+	
+	for (size_t g = 0; g < groups.size(); g++)
+	{
+		for (size_t t = 0; t < tails.size(); t++)
+		{
+			string key = "nid/" + groups[g] + tails[t];
+			
+			tree.insert(key, (int) model.size());
+			model.insert(key);
+		}
+	}
+	
+	frozentree<string, int> frozen = tree.freeze();
+	
+	REQUIRE(frozen.size() == (int) model.size());
+	
+	// probe every key, plus keys between, before and after them all,
+	// and keys that stop short of or branch off the shared prefix
+	vector<string> probes = { "", "n", "nid", "nid/", "nic", "nie", "nid0", "nid/a", "nid/aaaaaaa",
+							  "nid/aaaaaaaa", "nid/aaaaaaaa\x01", "nid/aaaaaaab0", "nid/abcdefg",
+							  "nid/abcdefgi", "nid/c", "nid/\xff", "o" };
+	
+	for (auto& key : model)
+	{
+		probes.push_back(key);
+		probes.push_back(key + "5");
+		probes.push_back(key.substr(0, key.size() - 1));
+	}
+	
+	for (auto& probe : probes)
+	{
+		auto lower = model.lower_bound(probe);
+		auto upper = model.upper_bound(probe);
+		auto frozenlower = frozen.lower_bound(probe);
+		auto frozenupper = frozen.upper_bound(probe);
+		
+		INFO("probe: " << probe);
+		
+		REQUIRE(frozenlower.done() == (lower == model.end()));
+		REQUIRE(frozenupper.done() == (upper == model.end()));
+		
+		if (lower != model.end())
+			REQUIRE(frozenlower.key() == *lower);
+		
+		if (upper != model.end())
+			REQUIRE(frozenupper.key() == *upper);
+		
+		REQUIRE((frozen.search(probe) != nullptr) == (model.count(probe) == 1));
+	}
+}
+
+TEST_CASE("(4) frozentree bounds on numbers, -0.0 and equal ordinals") 
+{
+	vector<double> keys = { -1e300, -2.5, -1, -0.0, 0.5, 1, 3.25, 1e300 };
+	avltree<double, int> tree;
+	
+	for (size_t i = 0; i < keys.size(); i++)
+		tree.insert(keys[i], (int) i);
+	
+	frozentree<double, int> frozen = tree.freeze();
+	
+	REQUIRE(frozen.search(0.0) != nullptr);
+	REQUIRE(frozen.search(-0.0) != nullptr);
+	REQUIRE(frozen.lower_bound(-0.5).key() == 0.0);
+	REQUIRE(frozen.upper_bound(0.0).key() == 0.5);
+	REQUIRE(frozen.upper_bound(-3).key() == -2.5);
+	REQUIRE(frozen.lower_bound(-1e301).key() == -1e300);
+	REQUIRE(frozen.upper_bound(1e300).done());
+}
+
+TEST_CASE("(5) hashtable finds every key through random inserts and erases") 
+{
+	hashtable<int, int> table;
+	map<int, int> model;
+	mt19937 random(341);
+	
+	for (int round = 0; round < 40; round++)
+	{
+		// erases shift the keys after them back; a small key range keeps
+		// the runs long, and some of them wrap past the end of the table
+		for (int i = 0; i < 300; i++)
+		{
+			int key = (int) (random() % 600);
+			
+			if (random() % 2 == 0)
+			{
+				REQUIRE(table.erase(key) == (model.erase(key) == 1));
+			}
+			else
+			{
+				table.insert(key, key + 7);
+				model.insert(make_pair(key, key + 7));
+			}
+		}
+		
+		REQUIRE(table.size() == (int) model.size());
+		
+		for (int key = 0; key < 600; key++)
+		{
+			int* value = table.search(key);
+			
+			INFO("key: " << key);
+			REQUIRE((value != nullptr) == (model.count(key) == 1));
+			
+			if (value != nullptr)
+				REQUIRE(*value == model[key]);
+		}
+	}
+}
+
+TEST_CASE("(6) hashtable erase with string keys") 
+{
+	hashtable<string, int> table;
+	
+	for (int i = 0; i < 100; i++)
+		table.insert("key" + to_string(i), i);
+	
+	for (int i = 0; i < 100; i += 3)
+		REQUIRE(table.erase("key" + to_string(i)));
+	
+	REQUIRE_FALSE(table.erase("key0"));
+	REQUIRE(table.size() == 66);
+	
+	for (int i = 0; i < 100; i++)
+		REQUIRE((table.search("key" + to_string(i)) != nullptr) == (i % 3 != 0));
+}
+
+TEST_CASE("(7) spatialindex removes points tied with the medians") 
+{
+	// a 4 x 4 grid of corners, so most points equal a median on the
+	// coordinate they are split by and could sit on either side of it
+	vector<double> lats, lons;
+	vector<streamoff> positions;
+	mt19937 random(451);
+	
+	for (streamoff pos = 0; pos < 400; pos++)
+	{
+		lats.push_back(41.8 + 0.01 * (random() % 4));
+		lons.push_back(-87.6 + 0.01 * (random() % 4));
+		positions.push_back(pos);
+	}
+	
+	spatialindex index;
+	index.build(lats, lons, positions);
+	
+	set<streamoff> model(positions.begin(), positions.end());
+	
+	// remove most of them in a random order (a rebuild happens halfway)
+	vector<streamoff> order = positions;
+	shuffle(order.begin(), order.end(), random);
+	
+	for (size_t i = 0; i < 300; i++)
+	{
+		streamoff pos = order[i];
+		
+		index.remove(lats[pos], lons[pos], pos);
+		model.erase(pos);
+		
+		REQUIRE(index.size() == model.size());
+		
+		if (i % 25 == 0)
+		{
+			vector<streamoff> inside = index.within(41.7, -87.7, 41.9, -87.5);
+			
+			REQUIRE(inside == vector<streamoff>(model.begin(), model.end()));
+		}
+	}
+	
+	vector<streamoff> inside = index.within(41.7, -87.7, 41.9, -87.5);
+	
+	REQUIRE(inside == vector<streamoff>(model.begin(), model.end()));
+	
+	// and every point left is still its own nearest
+	for (streamoff pos : model)
+	{
+		vector<pair<double, streamoff>> nearest = index.nearest(1, lats[pos], lons[pos]);
+		
+		REQUIRE(nearest.size() == 1);
+		REQUIRE(nearest[0].first < 1e-6);
+	}
 }
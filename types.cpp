@@ -0,0 +1,199 @@
+/*types.cpp*/
+
+// Column types for myDB project
+
+#include <iostream>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+
+#include "types.h"
+
+using namespace std;
+
+
+//
+// ParseColumnType
+//
+// Sets type from its name in the .meta file: int, double, date or
+// string.  Returns false if the name isn't a type.
+//
+bool ParseColumnType(string name, columntype& type)
+{
+	if (name == "string")
+		type = TYPE_STRING;
+	else if (name == "int")
+		type = TYPE_INT;
+	else if (name == "double")
+		type = TYPE_DOUBLE;
+	else if (name == "date")
+		type = TYPE_DATE;
+	else
+		return false;
+	
+	return true;
+}
+
+
+//
+// ColumnTypeName
+//
+// Returns the .meta file name of a type.
+//
+string ColumnTypeName(columntype type)
+{
+	switch (type)
+	{
+		case TYPE_STRING:
+			return "string";
+		case TYPE_INT:
+			return "int";
+		case TYPE_DOUBLE:
+			return "double";
+		case TYPE_DATE:
+			return "date";
+	}
+	
+	return "string";
+}
+
+
+//
+// _parsedigits
+//
+// Parses the unsigned decimal number in [data, data+length).  Returns
+// false if it is empty, has a non-digit or doesn't fit in an int64_t.
+//
+static bool _parsedigits(const char* data, size_t length, int64_t& value)
+{
+	if (length == 0)
+		return false;
+	
+	uint64_t result = 0;
+	
+	for (size_t i = 0; i < length; i++)
+	{
+		if (data[i] < '0' || data[i] > '9')
+			return false;
+		
+		result = result * 10 + (data[i] - '0');
+		
+		if (result > (uint64_t) INT64_MAX)
+			return false;
+	}
+	
+	value = (int64_t) result;
+	return true;
+}
+
+
+//
+// _parsedate
+//
+// Parses M/D/YYYY or YYYY-MM-DD into the integer YYYYMMDD, so dates
+// order the same way as their integers.  Returns false if it isn't a
+// date.
+//
+static bool _parsedate(const char* data, size_t length, int64_t& value)
+{
+	const char* end = data + length;
+	int64_t parts[3];
+	char separator = (memchr(data, '/', length) != nullptr) ? '/' : '-';
+	
+	// split into three numbers around the separators
+	for (int i = 0; i < 3; i++)
+	{
+		const char* stop = (i < 2) ? (const char*) memchr(data, separator, end - data) : end;
+		
+		if (stop == nullptr || !_parsedigits(data, stop - data, parts[i]))
+			return false;
+		
+		data = (stop < end) ? stop + 1 : end;
+	}
+	
+	int64_t year, month, day;
+	
+	if (separator == '/')
+	{
+		month = parts[0];
+		day = parts[1];
+		year = parts[2];
+	}
+	else
+	{
+		year = parts[0];
+		month = parts[1];
+		day = parts[2];
+	}
+	
+	if (month < 1 || month > 12 || day < 1 || day > 31 || year > 9999)
+		return false;
+	
+	value = year * 10000 + month * 100 + day;
+	return true;
+}
+
+
+//
+// ParseValue
+//
+// Parses a column value as the given type, into the key type its index
+// tree uses: a string for strings, an int64_t for ints and dates, a
+// double for doubles.  Returns false if the value isn't valid for the
+// type.
+//
+// Example: ParseValue("5/12/2015", 9, TYPE_DATE, key) sets key to 20150512.
+//
+bool ParseValue(const char* data, size_t length, columntype type, string& value)
+{
+	if (type != TYPE_STRING)
+		return false;
+	
+	value.assign(data, length);
+	return true;
+}
+
+bool ParseValue(const char* data, size_t length, columntype type, int64_t& value)
+{
+	if (type == TYPE_DATE)
+		return _parsedate(data, length, value);
+	
+	if (type != TYPE_INT || length == 0)
+		return false;
+	
+	bool negative = (data[0] == '-');
+	
+	if (data[0] == '-' || data[0] == '+')
+	{
+		data++;
+		length--;
+	}
+	
+	if (!_parsedigits(data, length, value))
+		return false;
+	
+	if (negative)
+		value = -value;
+	
+	return true;
+}
+
+bool ParseValue(const char* data, size_t length, columntype type, double& value)
+{
+	// strtod needs a terminated copy; no number is longer than this
+	char buffer[64];
+	
+	if (type != TYPE_DOUBLE || length == 0 || length >= sizeof(buffer))
+		return false;
+	
+	memcpy(buffer, data, length);
+	buffer[length] = '\0';
+	
+	char* end;
+	value = strtod(buffer, &end);
+	
+	// the whole value has to be the number, and nan never compares
+	return end == buffer + length && !std::isnan(value);
+}
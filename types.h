@@ -0,0 +1,35 @@
+/*types.h*/
+
+// Column types for myDB project
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <cstdint>
+
+using namespace std;
+
+//
+// columntype
+//
+// How a column's values compare, from the optional third word of its
+// line in the .meta file ("id 1 int").  Columns without one are strings.
+//
+enum columntype
+{
+	TYPE_STRING, // compared byte by byte
+	TYPE_INT,    // signed 64-bit integer
+	TYPE_DOUBLE, // floating point
+	TYPE_DATE    // M/D/YYYY or YYYY-MM-DD, kept as the integer YYYYMMDD
+};
+
+bool ParseColumnType(string name, columntype& type);
+
+string ColumnTypeName(columntype type);
+
+bool ParseValue(const char* data, size_t length, columntype type, string& value);
+
+bool ParseValue(const char* data, size_t length, columntype type, int64_t& value);
+
+bool ParseValue(const char* data, size_t length, columntype type, double& value);
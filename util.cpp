@@ -7,8 +7,10 @@
 #include <vector>
 #include <string>
 #include <sstream>
+#include <algorithm>
 
 #include "util.h"
+#include "stats.h"
 
 using namespace std;
 
@@ -25,32 +27,37 @@ using namespace std;
 //
 void EchoData(string tablename, int recordSize, int numColumns)
 {
-  string   filename = tablename + ".data";
-  ifstream data(filename, ios::in | ios::binary);
+  string    filename = tablename + ".data";
+  datatable table;
 
-  if (!data.good())
+  if (!table.open(tablename, recordSize, numColumns))
   {
     cout << "**Error: couldn't open data file '" << filename << "'." << endl;
     return;
   }
 
   //
-  // Okay, read file record by record, and output each record of values:
+  // Okay, walk the mapping record by record, and output each record of values:
   //
-  data.seekg(0, data.end);  // move to the end to get length of file:
-  streamoff length = data.tellg();
-
+  vector<fieldview> fields(numColumns);
+  streamoff length = table.numrecords() * recordSize;
   streamoff pos = 0;  // first record at offset 0:
-  string    value;
+  recordpin pin;
 
   while (pos < length)
   {
-    data.seekg(pos, data.beg);  // move to start of record:
+    if (*pin.at(table, pos) == '.')  // skip deleted records:
+    {
+      pos += recordSize;
+      continue;
+    }
+
+    table.columns(pos, &fields[0]);
 
-    for (int i = 0; i < numColumns; ++i)  // read values, one per column:
+    for (int i = 0; i < numColumns; ++i)  // output values, one per column:
     {
-      data >> value;
-      cout << value << " ";
+      cout.write(fields[i].Data, fields[i].Length);
+      cout << " ";
     }
 
     cout << endl;
@@ -63,44 +70,33 @@ void EchoData(string tablename, int recordSize, int numColumns)
 // GetRecord
 //
 // Reads a record of data values and returns these values in a vector.
-// Pass the table name, the file position (a stream offset), and the # 
-// of columns per record.
+// Pass the open table and the file position (a stream offset) of the
+// record; the record is read straight out of the table's mapping.
 //
-// Example: GetRecord(�students�, 0, 5) would read the first student
-// record in �students.data�.
+// Example: GetRecord(table, 0) would read the first student record
+// when table has "students.data" open.
 // 
-vector<string> GetRecord(string tablename, streamoff pos, int numColumns)
+vector<string> GetRecord(const datatable& table, streamoff pos)
 {
+	scopedtimer timer(TIME_GETRECORD);
 	vector<string>  values;
+	vector<fieldview> fields(table.numcolumns());
 	
-	// open the file...
-	string filename = tablename + ".data";
-	ifstream data(filename, ios::in | ios::binary);
-
-	// make sure it opened...
-	if (!data.good())
-	{
-		cout << "**Error: couldn't open data file '" << filename << "'." << endl;
+	// make sure the table is open...
+	if (!table.good())
 		return values;
-	}
 	
-	string value;
-	// seekg to the given position...
-	data.seekg(pos, data.beg);
+	// view each column of the record in place...
+	recordpin pin(table, pos);
+	StatCount(COUNT_BYTESREAD, table.recordsize());
+	table.columns(pos, &fields[0]);
 	
-	for (int i = 0; i < numColumns; i++)
+	for (size_t i = 0; i < fields.size(); i++)
 	{
-		// loop and input values using >>...
-		data >> value;
-		// store into vector...
-		values.push_back(value);
+		// copy out and store into vector...
+		values.push_back(fields[i].str());
 	}
 
-	//
-	// open the file, make sure it opened, seekg to the given position,
-	// loop and input values using >>, store into vector, return vector
-	//
-
 	// return vector
 	return values;
 }
@@ -110,62 +106,111 @@ vector<string> GetRecord(string tablename, streamoff pos, int numColumns)
 // LinearSearch
 //
 // Searches the contents of a .data file record by record; the first 
-// three parameters are the tablename, record size, and # of columns.
-// The 4th parameter specifies the value to search for: matchValue.
-// The 5th parameter is the record column to match against --- pass
-// 1 for the first column, 2 for the 2nd column, and so on.  All matches
-// are exact matches.
-//
-// Example: LinearSearch(�students�, 82, 5, "kim", 3) would search the 
-// "students.data" file for all records whose 3rd column --- lastname ---
-// matches "kim".  There are 2 matches (records 3 and 6), so their file 
-// positions of 164 and 410 would be returned in the vector.
+// parameter is the open table.  The 2nd parameter specifies the value
+// to search for: matchValue.  The 3rd parameter is the record column
+// to match against --- pass 0 for the first column, 1 for the 2nd
+// column, and so on.  The 4th parameter is the # of threads to split
+// the scan across (1 by default).  All matches are exact matches, and
+// are returned in file order.
+//
+// Example: LinearSearch(table, "kim", 2) would search the "students.data"
+// file for all records whose 3rd column --- lastname --- matches "kim".
+// There are 2 matches (records 3 and 6), so their file positions of
+// 164 and 410 would be returned in the vector.
 // 
-vector<streamoff> LinearSearch(string tablename, int recordSize, int numColumns, string matchValue, int matchColumn)
+vector<streamoff> LinearSearch(const datatable& table, string matchValue, int matchColumn, int numThreads)
 {
 	vector<streamoff>  matches;
-	vector<string> valuevect;
-	string temp;
-	int linecount = 0;
-	streamoff curpos;
 	
-	// open the file...
-	string  filename = tablename + ".data";
-	ifstream data(filename, ios::in | ios::binary);
+	// make sure the table is open...
+	if (!table.good())
+		return matches;
+	
+	predicate pred;
+	pred.Op = OP_EQUAL;
+	pred.Value = matchValue;
 	
-	// make sure it opened...
-	if (!data.good())
-	{
-		cout << "**Error: couldn't open data file '" << filename << "'." << endl;
+	matches = LinearSearch(table, pred, matchColumn, numThreads);
+
+	// return vector
+	return matches;
+}
+
+
+//
+// LinearSearch
+//
+// Same as above, but matches records against a where clause predicate
+// (=, <, <=, >, >=, between or prefix) instead of an exact value.
+//
+// Example: LinearSearch(table, {OP_PREFIX, "k"}, 2) would return the
+// positions of every student whose lastname starts with "k".
+// 
+vector<streamoff> LinearSearch(const datatable& table, const predicate& pred, int matchColumn, int numThreads)
+{
+	scopedtimer timer(TIME_LINEARSEARCH);
+	vector<streamoff>  matches;
+	
+	// make sure the table is open...
+	if (!table.good())
 		return matches;
-	}
 	
-	// loop through data file line by line (for line count)
-	while (!data.eof())
-	{
-		getline(data, temp);
-		linecount++;
-	}
+	// one vectorized pass over every record in the mapping...
+	StatCount(COUNT_BYTESREAD, table.numrecords() * table.recordsize());
 	
-	// loop through record by record...
-	for (int i = 0; i < linecount - 1; i++)
+	if (numThreads > 1)
+		matches = ParallelScanColumn(table, pred, matchColumn, numThreads);
+	else
+		matches = ScanColumn(table, pred, matchColumn, 0, table.numrecords());
+
+	// return vector
+	return matches;
+}
+
+
+//
+// ReadIndexColumns
+//
+// Walks the contents of a table once, and collects the values of the
+// given columns paired with their record's file position.  Pass the
+// open table and the column numbers (0-based) to collect.  Returns one
+// vector of (value, position) pairs per requested column, in file order.
+//
+// Example: ReadIndexColumns(table, {0, 3}) would return the uin and
+// netid values of every student record along with the file positions
+// 0, 82, 164, ...
+//
+vector<vector<pair<string, streamoff>>> ReadIndexColumns(const datatable& table, vector<int> indexColumns)
+{
+	vector<vector<pair<string, streamoff>>> columns(indexColumns.size());
+	
+	// make sure the table is open...
+	if (!table.good())
+		return columns;
+	
+	streamoff numrecords = table.numrecords();
+	streamoff recordsize = table.recordsize();
+	vector<fieldview> fields(table.numcolumns());
+	
+	for (size_t i = 0; i < columns.size(); i++)
+		columns[i].reserve(numrecords);
+	
+	StatCount(COUNT_BYTESREAD, numrecords * recordsize);
+	
+	recordpin pin;
+	
+	// loop through each record in the mapping, skipping deleted ones...
+	for (streamoff pos = 0; pos < numrecords * recordsize; pos += recordsize)
 	{
-		curpos = i * recordSize;
+		if (*pin.at(table, pos) == '.')
+			continue;
 		
-		valuevect = GetRecord(tablename, curpos, numColumns);
+		table.columns(pos, &fields[0]);
 		
-		// look for matches...
-		if (valuevect[matchColumn] == matchValue)
-			// add file position to vector
-			matches.push_back(curpos);
+		for (size_t i = 0; i < indexColumns.size(); i++)
+			columns[i].push_back(make_pair(fields[indexColumns[i]].str(), pos));
 	}
-
-	//
-	// open the file, make sure it opened, loop through record by 
-	// record looking for matches.  For each match found, add file
-	// position to vector.
-	//
-
+	
 	// return vector
-	return matches;
+	return columns;
 }
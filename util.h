@@ -9,11 +9,58 @@
 #include <vector>
 #include <string>
 #include <sstream>
+#include <utility>
+#include <algorithm>
+
+#include "postings.h"
+#include "table.h"
+#include "scan.h"
 
 using namespace std;
 
 void EchoData(string tablename, int recordSize, int numColumns);
 
-vector<string> GetRecord(string tablename, streamoff pos, int numColumns);
+vector<string> GetRecord(const datatable& table, streamoff pos);
+
+vector<streamoff> LinearSearch(const datatable& table, string matchValue, int matchColumn, int numThreads = 1);
+
+vector<streamoff> LinearSearch(const datatable& table, const predicate& pred, int matchColumn, int numThreads = 1);
+
+vector<vector<pair<string, streamoff>>> ReadIndexColumns(const datatable& table, vector<int> indexColumns);
+
 
-vector<streamoff> LinearSearch(string tablename, int recordSize, int numColumns, string matchValue, int matchColumn);
+//
+// GroupIndexColumn
+//
+// Sorts one column's (value, position) pairs from ReadIndexColumns by
+// value, and groups them into the sorted distinct keys and a posting
+// list per key, ready for avltree::build.  The sort is stable, so each
+// key's positions stay in file order.  columnPairs is emptied.  Keys
+// are strings, or the parsed values of a typed column (see columnindex).
+//
+template<typename TKey>
+void GroupIndexColumn(vector<pair<TKey, streamoff>>& columnPairs, vector<TKey>& keys, vector<postinglist>& values)
+{
+	// sort by key, stable so each key's records stay in file order
+	stable_sort(columnPairs.begin(), columnPairs.end(),
+		[](const pair<TKey, streamoff>& a, const pair<TKey, streamoff>& b)
+		{ return a.first < b.first; });
+	
+	// split into keys/posting lists, every record of a key goes in its list
+	keys.clear();
+	values.clear();
+	keys.reserve(columnPairs.size());
+	values.reserve(columnPairs.size());
+	for (size_t j = 0; j < columnPairs.size(); j++)
+	{
+		if (keys.empty() || keys.back() != columnPairs[j].first)
+		{
+			keys.push_back(columnPairs[j].first);
+			values.push_back(postinglist());
+		}
+		
+		values.back().add(columnPairs[j].second);
+	}
+	
+	columnPairs.clear();
+}